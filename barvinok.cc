@@ -38,6 +38,7 @@
 #include "bernoulli.h"
 #include "param_util.h"
 #include "summate.h"
+#include "topcom.h"
 
 using namespace NTL;
 using std::cerr;
@@ -500,6 +501,8 @@ static void barvinok_count_f(Polyhedron *P, Value* result,
 	cnt = new icounter(P->Dimension);
     else if (options->incremental_specialization == BV_SPECIALIZATION_TODD)
 	cnt = new tcounter(P->Dimension, options->max_index);
+    else if (options->incremental_specialization == BV_SPECIALIZATION_MODULAR)
+	cnt = new mcounter(P->Dimension, options->max_index);
     else
 	cnt = new counter(P->Dimension, options->max_index);
     cnt->start(P, options);
@@ -515,6 +518,8 @@ struct enumerator_base {
     evalue ** vE;
     evalue mone;
     vertex_decomposer *vpd;
+    /* fractional parts shared by the cones at all vertices */
+    fractional_part_cache fp_cache;
 
     enumerator_base(unsigned dim, vertex_decomposer *vpd)
     {
@@ -592,7 +597,7 @@ void enumerator::handle(const signed_cone& sc, barvinok_options *options)
 	    throw Orthogonal;
     }
 
-    lattice_point(V, sc.rays, lambda, &num, sc.det, options);
+    lattice_point(V, sc.rays, lambda, &num, sc.det, options, &fp_cache);
     den = sc.rays * lambda;
 
     if (dim % 2)
@@ -686,6 +691,7 @@ void cumulator::cumulate(barvinok_options *options)
     evalue t;	// E_num[0] - (m-1)
     evalue *cst;
     evalue mone;
+    vector<int> powers;
 
     if (options->lookup_table) {
 	value_init(mone.d);
@@ -723,18 +729,18 @@ void cumulator::cumulate(barvinok_options *options)
 	    emul(&t, &cum);
 	}
 	dpoly_r_term_list& current = r->c[r->len-1-m];
-	dpoly_r_term_list::iterator j;
-	for (j = current.begin(); j != current.end(); ++j) {
-	    if ((*j)->coeff == 0)
+	for (int j = 0; j < current.size(); ++j) {
+	    if (current.coeff(j) == 0)
 		continue;
 	    evalue *f2 = new evalue;
 	    value_init(f2->d);
 	    value_init(f2->x.n);
-	    zz2value((*j)->coeff, f2->x.n);
+	    zz2value(current.coeff(j), f2->x.n);
 	    zz2value(r->denom, f2->d);
 	    emul(&cum, f2);
 
-	    add_term((*j)->powers, f2);
+	    powers.assign(current.powers(j), current.powers(j) + r->dim);
+	    add_term(powers, f2);
 	}
     }
     free_evalue_refs(&f);
@@ -921,13 +927,12 @@ void ienumerator::reduce(evalue *factor, const mat_ZZ& num, const mat_ZZ& den_f,
 	    value_init(f.d);
 	    value_init(f.x.n);
 	    zz2value(r->denom, f.d);
-	    dpoly_r_term_list::iterator j;
-	    for (j = final.begin(); j != final.end(); ++j) {
-		if ((*j)->coeff == 0)
+	    for (int j = 0; j < final.size(); ++j) {
+		if (final.coeff(j) == 0)
 		    continue;
 		rows = common;
 		for (int k = 0; k < r->dim; ++k) {
-		    int n = (*j)->powers[k];
+		    int n = final.powers(j)[k];
 		    if (n == 0)
 			continue;
 		    pden.SetDims(rows+n, pden.NumCols());
@@ -937,7 +942,7 @@ void ienumerator::reduce(evalue *factor, const mat_ZZ& num, const mat_ZZ& den_f,
 		}
 		value_init(t.d);
 		evalue_copy(&t, factor);
-		zz2value((*j)->coeff, f.x.n);
+		zz2value(final.coeff(j), f.x.n);
 		emul(&f, &t);
 		reduce(&t, num_p, pden, options);
 		free_evalue_refs(&t);
@@ -976,7 +981,7 @@ void ienumerator::handle(const signed_cone& sc, barvinok_options *options)
     assert(sc.det == 1);
     assert(sc.rays.NumRows() == dim);
 
-    lattice_point(V, sc.rays, vertex[0], E_vertex, options);
+    lattice_point(V, sc.rays, vertex[0], E_vertex, options, &fp_cache);
 
     den = sc.rays;
 
@@ -1006,6 +1011,8 @@ struct bfenumerator : public vertex_decomposer, public bf_base,
     }
 
     virtual void handle(const signed_cone& sc, barvinok_options *options);
+    /* lattice_point does not take into account open rays */
+    virtual bool handles_open_rays() { return false; }
     virtual void base(mat_ZZ& factors, bfc_vec& v);
 
     bfc_term_base* new_bf_term(int len) {
@@ -1070,10 +1077,8 @@ struct bfenumerator : public vertex_decomposer, public bf_base,
 	int len = t->terms.NumRows()-1;	// already increased by one
 
 	bfet->factors.resize(len+1);
-	for (int j = len; j > i; --j) {
+	for (int j = len; j > i; --j)
 	    bfet->factors[j] = bfet->factors[j-1];
-	    t->terms[j] = t->terms[j-1];
-	}
 	bfet->factors[i] = factor;
 	factor = NULL;
     }
@@ -1127,7 +1132,7 @@ void bfe_cum::add_term(const vector<int>& powers, evalue *f2)
 {
     bfr->update_powers(powers);
 
-    bfc_term_base * t = bfe->find_bfc_term(bfr->vn, bfr->npowers, bfr->nnf);
+    bfc_term_base * t = bfr->find_bfc_term(bfr->npowers);
     bfe->set_factor(f2, bfr->l_changes % 2);
     bfe->add_term(t, told->terms[k], bfr->l_extra_num);
 }
@@ -1161,8 +1166,10 @@ void bfenumerator::handle(const signed_cone& sc, barvinok_options *options)
 
     t->factors.resize(1);
 
-    t->terms.SetDims(1, enumerator_base::dim);
-    lattice_point(V, sc.rays, t->terms[0], E_vertex, options);
+    vec_ZZ num;
+    lattice_point(V, sc.rays, num, E_vertex, options, &fp_cache);
+    t->terms.SetDims(1, num.length());
+    t->terms.set(0, num);
 
     // the elements of factors are always lexpositive
     mat_ZZ   factors;
@@ -1464,6 +1471,53 @@ static evalue* barvinok_enumerate_ev_f(Polyhedron *P, Polyhedron* C,
     return eres;
 }
 
+/* Compute the number of integer points in P as a function of
+ * the parameters, but only on the chambers that contain one of
+ * the points in the rows of "points".
+ * The result is only valid on the domains of the returned partition
+ * and only the vertices that are active in those chambers are considered.
+ * Inputs that are treated specially by barvinok_enumerate_with_options
+ * (equalities, unbounded polyhedra, approximations, ...)
+ * are handled by computing the complete result instead.
+ */
+evalue *barvinok_enumerate_at_points(Polyhedron *P, Polyhedron *C,
+				     Matrix *points,
+				     struct barvinok_options *options)
+{
+    unsigned nparam = C->Dimension;
+    Polyhedron *C1, *TC;
+    Param_Polyhedron *PP;
+    evalue *eres;
+
+    assert(points->NbColumns == nparam);
+
+    if (P->next || C->next || nparam == 0 ||
+	options->approx->method != BV_APPROX_NONE ||
+	options->summation == BV_SUM_EULER ||
+	options->summation == BV_SUM_BERNOULLI)
+	return barvinok_enumerate_with_options(P, C, options);
+
+    C1 = Polyhedron_Project(P, nparam);
+    TC = DomainIntersection(C, C1, options->MaxRays);
+    Polyhedron_Free(C1);
+    POL_ENSURE_VERTICES(P);
+    POL_ENSURE_VERTICES(TC);
+    if (emptyQ(P) || emptyQ(TC) || P->NbEq != 0 || TC->NbEq != 0 ||
+	P->Dimension == nparam ||
+	Polyhedron_is_unbounded(P, nparam, options->MaxRays)) {
+	Polyhedron_Free(TC);
+	return barvinok_enumerate_with_options(P, C, options);
+    }
+
+    PP = TC_P2PP_at_points(P, TC, points, options);
+    eres = Param_Polyhedron_Enumerate(PP, P, TC, options);
+    Param_Polyhedron_Free(PP);
+    Polyhedron_Free(TC);
+    reduce_evalue(eres);
+
+    return eres;
+}
+
 Enumeration* barvinok_enumerate(Polyhedron *P, Polyhedron* C, unsigned MaxRays)
 {
     evalue *EP = barvinok_enumerate_ev(P, C, MaxRays);
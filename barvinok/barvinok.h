@@ -20,6 +20,9 @@ evalue* barvinok_enumerate_with_options(Polyhedron *P, Polyhedron* C,
 evalue *Param_Polyhedron_Enumerate(Param_Polyhedron *PP, Polyhedron *P,
 				   Polyhedron *C,
 				   struct barvinok_options *options);
+evalue *barvinok_enumerate_at_points(Polyhedron *P, Polyhedron *C,
+				     Matrix *points,
+				     struct barvinok_options *options);
 evalue* barvinok_enumerate_e(Polyhedron *P, 
 			  unsigned exist, unsigned nparam, unsigned MaxRays);
 evalue* barvinok_enumerate_e_with_options(Polyhedron *P, 
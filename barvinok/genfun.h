@@ -25,6 +25,8 @@ struct short_rat {
     } d;
     void add(const short_rat *rat);
     QQ coefficient(Value* params, barvinok_options *options) const;
+    void coefficients(Matrix *points, vec_QQ& c,
+		      barvinok_options *options) const;
     bool reduced();
     short_rat(const short_rat& r);
     short_rat(Value c);
@@ -60,6 +62,8 @@ struct gen_fun {
     operator evalue *() const;
     ZZ coefficient(Value* params, barvinok_options *options) const;
     void coefficient(Value* params, Value* c) const;
+    void coefficients(Matrix *points, Value *c,
+		      barvinok_options *options) const;
     gen_fun *summate(int nvar, barvinok_options *options) const;
     bool summate(Value *sum) const;
     bool is_zero() const;
@@ -83,6 +87,9 @@ struct gen_fun {
 private:
     void extend_context(const gen_fun *gf, barvinok_options *options);
     void add(const QQ& c, const gen_fun *gf);
+    static gen_fun *Hadamard_product(const short_rat *r1, const short_rat *r2,
+				     Polyhedron *C, barvinok_options *options);
+    friend struct Hadamard_pairs;
 };
 
 std::ostream & operator<< (std::ostream & os, const gen_fun& gf);
@@ -17,9 +17,23 @@ struct barvinok_stats {
     long	topcom_distinct_chambers;
     long	gbr_solved_lps;
     long	bernoulli_sums;
+    long	lll_exact;
+    long	lll_fp;
+    long	lll_fp_fallbacks;
+    long	svp_reductions;
+    long	svp_shorter;
+    long	decompose_max_cones;
+    long	decompose_max_bytes;
+    long	modular_primes;
+    long	modular_fallbacks;
+    long	enumerate_e_memo_hits;
+    long	enumerate_e_memo_misses;
+    long	hilbert_int64;
 };
 
 void barvinok_stats_clear(struct barvinok_stats *stats);
+void barvinok_stats_merge(struct barvinok_stats *dst,
+			  struct barvinok_stats *src);
 void barvinok_stats_print(struct barvinok_stats *stats, FILE *out);
 
 struct barvinok_approximation_options {
@@ -57,16 +71,30 @@ struct barvinok_options {
 		/* LLL reduction parameter delta=LLL_a/LLL_b */
     long	LLL_a;
     long	LLL_b;
+    #define	BV_LLL_EXACT		0
+    #define	BV_LLL_FP		1
+    #define	BV_LLL_AUTO		2
+    int		LLL_engine;
+		/* block size of BKZ reduction after LLL reduction */
+    unsigned long	svp_dimension;
 
     /* barvinok options */
     #define	BV_SPECIALIZATION_BF		2
     #define	BV_SPECIALIZATION_DF		1
     #define	BV_SPECIALIZATION_RANDOM	0
     #define	BV_SPECIALIZATION_TODD		3
+    #define	BV_SPECIALIZATION_MODULAR	4
     int		incremental_specialization;
 
     unsigned long   	    max_index;
     int		    	    primal;
+    int		    	    half_open;
+    #define	BV_DECOMPOSE_DFS	0
+    #define	BV_DECOMPOSE_BFS	1
+    #define	BV_DECOMPOSE_DET	2
+    int				decompose_order;
+		/* maximal size in bytes of the cones waiting to be split */
+    unsigned long		decompose_memory;
     int		    	    lookup_table;
     int		    	    count_sample_infinite;
 
@@ -109,6 +137,19 @@ struct barvinok_options {
 
     int		gbr_only_first;
 
+		/* maximal number of memoized existential subproblems */
+    unsigned long	enumerate_e_memo;
+		/* memoized existential subproblems of the current call */
+    struct enumerate_e_memo	*enumerate_e_memo_table;
+
+    /* maximal total number of threads */
+    unsigned long	threads;
+		/* maximal number of cones waiting to be consumed */
+    unsigned long	cone_queue;
+    char		*save_cones;
+    char		*load_cones;
+    FILE		*cone_file;
+
     int gist;
 };
 
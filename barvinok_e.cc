@@ -1,5 +1,9 @@
 #include <assert.h>
 #include <gmp.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
 #include <isl/ctx.h>
 #include <isl/space.h>
 #include <isl/set.h>
@@ -7,10 +11,16 @@
 #include <barvinok/barvinok.h>
 #include <barvinok/evalue.h>
 #include <barvinok/util.h>
+#include "enumerate_e_memo.h"
 #include "param_util.h"
+#include "parallel.h"
 #include "reduce_domain.h"
 #include "config.h"
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #define ALLOC(type) (type*)malloc(sizeof(type))
 
 Polyhedron *unfringe (Polyhedron *P, unsigned MaxRays)
@@ -279,6 +289,48 @@ INDEPENDENT = 1 << 2,
 ROT_NEG = 1 << 3
 };
 
+/* The pieces into which a problem is split by enumerate_or, split_sure
+ * or SplitOnVar.  The pieces are enumerated independently of each other,
+ * possibly in parallel, but the caller combines the results
+ * in the order of the pieces such that the final result
+ * does not depend on the order in which the pieces are enumerated.
+ * The pieces and their enumerations are owned by this object,
+ * such that they are also freed if an enumeration throws an exception.
+ * The caller takes over an enumeration by calling take.
+ */
+struct enumerate_e_pieces : public parallel_body {
+    std::vector<Polyhedron *> P;
+    std::vector<unsigned> exist;
+    std::vector<evalue *> E;
+    unsigned nparam;
+
+    enumerate_e_pieces(unsigned nparam) : nparam(nparam) {}
+    ~enumerate_e_pieces() {
+	for (int i = 0; i < P.size(); ++i) {
+	    if (E[i])
+		evalue_free(E[i]);
+	    Polyhedron_Free(P[i]);
+	}
+    }
+    void add(Polyhedron *Q, unsigned n) {
+	P.push_back(Q);
+	exist.push_back(n);
+	E.push_back(NULL);
+    }
+    evalue *take(int i) {
+	evalue *res = E[i];
+	E[i] = NULL;
+	return res;
+    }
+    void enumerate(barvinok_options *options) {
+	parallel_for(P.size(), *this, options);
+    }
+    virtual void run(int i, barvinok_options *options) {
+	E[i] = barvinok_enumerate_e_with_options(P[i], exist[i], nparam,
+						 options);
+    }
+};
+
 static evalue* enumerate_or(Polyhedron *D,
 		      unsigned exist, unsigned nparam, barvinok_options *options)
 {
@@ -286,23 +338,17 @@ static evalue* enumerate_or(Polyhedron *D,
     fprintf(stderr, "\nER: Or\n");
 #endif /* DEBUG_ER */
 
-    Polyhedron *N = D->next;
-    D->next = 0;
-    evalue *EP = 
-	barvinok_enumerate_e_with_options(D, exist, nparam, options);
-    Polyhedron_Free(D);
-
-    for (D = N; D; D = N) {
+    enumerate_e_pieces pieces(nparam);
+    for (Polyhedron *N; D; D = N) {
 	N = D->next;
 	D->next = 0;
-
-	evalue *EN = 
-	    barvinok_enumerate_e_with_options(D, exist, nparam, options);
-
-	eor(EN, EP);
-	evalue_free(EN);
-	Polyhedron_Free(D);
+	pieces.add(D, exist);
     }
+    pieces.enumerate(options);
+
+    evalue *EP = pieces.take(0);
+    for (int i = 1; i < pieces.P.size(); ++i)
+	eor(pieces.E[i], EP);
 
     reduce_evalue(EP);
 
@@ -364,23 +410,24 @@ static evalue* split_sure(Polyhedron *P, Polyhedron *S,
 	value_set_si(M->p[j][j], 1);
     for (int j = 0; j < nparam+1; ++j)
 	value_set_si(M->p[nvar+j][nvar+exist+j], 1);
-    Polyhedron *T = Polyhedron_Image(S, M, options->MaxRays);
-    evalue *EP = barvinok_enumerate_e_with_options(T, 0, nparam, options);
+    enumerate_e_pieces pieces(nparam);
+    pieces.add(Polyhedron_Image(S, M, options->MaxRays), 0);
     Polyhedron_Free(S);
-    Polyhedron_Free(T);
     Matrix_Free(M);
 
     for (Polyhedron *Q = D; Q; Q = Q->next) {
 	Polyhedron *N = Q->next;
 	Q->next = 0;
-	T = DomainIntersection(P, Q, options->MaxRays);
-	evalue *E = barvinok_enumerate_e_with_options(T, exist, nparam, options);
-	eadd(E, EP);
-	evalue_free(E);
-	Polyhedron_Free(T);
+	pieces.add(DomainIntersection(P, Q, options->MaxRays), exist);
 	Q->next = N;
     }
     Domain_Free(D);
+
+    pieces.enumerate(options);
+
+    evalue *EP = pieces.take(0);
+    for (int i = 1; i < pieces.P.size(); ++i)
+	eadd(pieces.E[i], EP);
     return EP;
 }
 
@@ -1114,6 +1161,180 @@ static bool is_single(Value *row, int pos, int len)
 static evalue* barvinok_enumerate_e_r(Polyhedron *P, 
 		      unsigned exist, unsigned nparam, barvinok_options *options);
 
+/* Results of barvinok_enumerate_e_r on the subproblems encountered
+ * while an enumerate_e_memo_scope is alive, i.e., by default,
+ * during an outermost call to barvinok_enumerate_e_with_options.
+ * The same subproblem, up to the order of the constraints, is frequently
+ * reached along different branches of the recursion.
+ * The table is cleared whenever it reaches options->enumerate_e_memo entries.
+ * Since the branches may be enumerated in parallel and the threads
+ * share the table through their copies of options, it is protected by a lock.
+ */
+struct enumerate_e_memo {
+    std::map<std::string, evalue *> table;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t mutex;
+#endif
+
+    enumerate_e_memo();
+    ~enumerate_e_memo();
+    void clear();
+    void lock();
+    void unlock();
+};
+
+#ifdef HAVE_PTHREAD
+enumerate_e_memo::enumerate_e_memo()
+{
+    pthread_mutex_init(&mutex, NULL);
+}
+
+enumerate_e_memo::~enumerate_e_memo()
+{
+    clear();
+    pthread_mutex_destroy(&mutex);
+}
+
+void enumerate_e_memo::lock()
+{
+    pthread_mutex_lock(&mutex);
+}
+
+void enumerate_e_memo::unlock()
+{
+    pthread_mutex_unlock(&mutex);
+}
+#else
+enumerate_e_memo::enumerate_e_memo()
+{
+}
+
+enumerate_e_memo::~enumerate_e_memo()
+{
+    clear();
+}
+
+void enumerate_e_memo::lock()
+{
+}
+
+void enumerate_e_memo::unlock()
+{
+}
+#endif
+
+void enumerate_e_memo::clear()
+{
+    std::map<std::string, evalue *>::iterator i;
+    for (i = table.begin(); i != table.end(); ++i)
+	evalue_free(i->second);
+    table.clear();
+}
+
+/* Attach a fresh table to options, unless one is already attached,
+ * and detach and free it again when the scope ends,
+ * also if the enumeration throws an exception.
+ */
+enumerate_e_memo_scope::enumerate_e_memo_scope(barvinok_options *options) :
+	options(options), memo(NULL)
+{
+    if (options->enumerate_e_memo && !options->enumerate_e_memo_table) {
+	memo = new enumerate_e_memo;
+	options->enumerate_e_memo_table = memo;
+    }
+}
+
+enumerate_e_memo_scope::~enumerate_e_memo_scope()
+{
+    if (!memo)
+	return;
+    options->enumerate_e_memo_table = NULL;
+    delete memo;
+}
+
+/* Construct a key for (P, exist, nparam) that does not depend
+ * on the order of the constraints of P.
+ * Equalities are normalized to have a positive first non-zero coefficient.
+ */
+static std::string enumerate_e_key(Polyhedron *P,
+				   unsigned exist, unsigned nparam)
+{
+    int len = P->Dimension + 2;
+    std::vector<std::string> rows;
+    Vector *row = Vector_Alloc(len);
+    char buf[32];
+
+    for (int i = 0; i < P->NbConstraints; ++i) {
+	Vector_Copy(P->Constraint[i], row->p, len);
+	if (value_zero_p(row->p[0])) {
+	    int pos = First_Non_Zero(row->p+1, len-1);
+	    if (pos != -1 && value_neg_p(row->p[1+pos]))
+		Vector_Oppose(row->p+1, row->p+1, len-1);
+	}
+	std::string r;
+	for (int j = 0; j < len; ++j) {
+	    char *str = mpz_get_str(NULL, 10, row->p[j]);
+	    r += str;
+	    r += ' ';
+	    free(str);
+	}
+	rows.push_back(r);
+    }
+    Vector_Free(row);
+    std::sort(rows.begin(), rows.end());
+
+    snprintf(buf, sizeof(buf), "%u %u %u;", P->Dimension, exist, nparam);
+    std::string key = buf;
+    for (int i = 0; i < rows.size(); ++i) {
+	key += rows[i];
+	key += ';';
+    }
+    return key;
+}
+
+/* Look up (P, exist, nparam) in the table attached to options,
+ * creating one for the duration of this call if there is none yet.
+ * The result of the outermost call is not stored since the table
+ * is freed right after.
+ */
+static evalue *barvinok_enumerate_e_memo(Polyhedron *P,
+		      unsigned exist, unsigned nparam, barvinok_options *options)
+{
+    if (!options->enumerate_e_memo)
+	return barvinok_enumerate_e_r(P, exist, nparam, options);
+
+    enumerate_e_memo_scope scope(options);
+    enumerate_e_memo *memo = options->enumerate_e_memo_table;
+    std::string key = enumerate_e_key(P, exist, nparam);
+    std::map<std::string, evalue *>::iterator i;
+    evalue *EP = NULL;
+
+    memo->lock();
+    i = memo->table.find(key);
+    if (i != memo->table.end())
+	EP = evalue_dup(i->second);
+    memo->unlock();
+
+    if (EP) {
+	options->stats->enumerate_e_memo_hits++;
+	return EP;
+    }
+    options->stats->enumerate_e_memo_misses++;
+    EP = barvinok_enumerate_e_r(P, exist, nparam, options);
+
+    if (scope.memo)
+	return EP;
+    memo->lock();
+    if (memo->table.find(key) == memo->table.end()) {
+	if (memo->table.size() >= options->enumerate_e_memo)
+	    memo->clear();
+	memo->table[key] = evalue_dup(EP);
+    }
+    memo->unlock();
+
+    return EP;
+}
+
 #ifdef DEBUG_ER
 static int er_level = 0;
 
@@ -1126,7 +1347,7 @@ evalue* barvinok_enumerate_e_with_options(Polyhedron *P,
     fprintf(stderr, "\nE %d\nP %d\n", exist, nparam);
     ++er_level;
     P = DomainConstraintSimplify(Polyhedron_Copy(P), options->MaxRays);
-    evalue *EP = barvinok_enumerate_e_r(P, exist, nparam, options);
+    evalue *EP = barvinok_enumerate_e_memo(P, exist, nparam, options);
     Polyhedron_Free(P);
     --er_level;
     return EP;
@@ -1136,7 +1357,7 @@ evalue* barvinok_enumerate_e_with_options(Polyhedron *P,
 			  unsigned exist, unsigned nparam, barvinok_options *options)
 {
     P = DomainConstraintSimplify(Polyhedron_Copy(P), options->MaxRays);
-    evalue *EP = barvinok_enumerate_e_r(P, exist, nparam, options);
+    evalue *EP = barvinok_enumerate_e_memo(P, exist, nparam, options);
     Polyhedron_Free(P);
     return EP;
 }
@@ -1424,14 +1645,12 @@ next:
 		fprintf(stderr, "\nER: Split\n");
 #endif /* DEBUG_ER */
 
-		evalue *EP = 
-		    barvinok_enumerate_e_with_options(neg, exist-1, nparam, options);
-		evalue *E = 
-		    barvinok_enumerate_e_with_options(pos, exist, nparam, options);
-		eadd(E, EP);
-		evalue_free(E);
-		Polyhedron_Free(neg);
-		Polyhedron_Free(pos);
+		enumerate_e_pieces pieces(nparam);
+		pieces.add(neg, exist-1);
+		pieces.add(pos, exist);
+		pieces.enumerate(options);
+		evalue *EP = pieces.take(0);
+		eadd(pieces.E[1], EP);
 		value_clear(f);
 		Vector_Free(row);
 		delete [] info;
@@ -0,0 +1,208 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <isl/ctx.h>
+#include <isl/point.h>
+#include <isl/set.h>
+#include <isl_set_polylib.h>
+#include <barvinok/polylib.h>
+#include <barvinok/barvinok.h>
+#include <barvinok/options.h>
+#include "verify.h"
+#include "config.h"
+
+/* Time barvinok_count_with_options on the instances of the parametric
+ * polytopes whose file names are read from standard input,
+ * for (at most 200) parameter values in the verification range.
+ * The number of points found is printed as well such that
+ * the results of different runs can be compared.
+ */
+
+#ifdef HAVE_SYS_TIMES_H
+
+#include <sys/times.h>
+
+typedef clock_t		my_clock_t;
+
+static my_clock_t time_diff(struct tms *before, struct tms *after)
+{
+	return after->tms_utime - before->tms_utime;
+}
+
+#else
+
+typedef int		my_clock_t;
+
+struct tms { int dummy; };
+static void times(struct tms* time)
+{
+}
+static my_clock_t time_diff(struct tms *before, struct tms *after)
+{
+	return 0;
+}
+
+#endif
+
+struct options {
+    int quiet;
+    struct verify_options    *verify;
+};
+
+ISL_ARGS_START(struct options, options_args)
+ISL_ARG_CHILD(struct options, verify, NULL, &verify_options_args, NULL)
+ISL_ARG_BOOL(struct options, quiet, 'q', "quiet", 0, NULL)
+ISL_ARGS_END
+
+ISL_ARG_DEF(options, struct options, options_args)
+
+struct bench_count_data {
+    struct verify_point_data vpd;
+    isl_set		    *set;
+    Value		     total;
+    my_clock_t		     ticks;
+};
+
+static isl_stat count_basic_set(__isl_take isl_basic_set *bset, void *user)
+{
+    struct bench_count_data *data = (struct bench_count_data *) user;
+    struct tms st_cpu;
+    struct tms en_cpu;
+    Polyhedron *P;
+    Value c;
+
+    P = isl_basic_set_to_polylib(bset);
+    isl_basic_set_free(bset);
+
+    value_init(c);
+    times(&st_cpu);
+    barvinok_count_with_options(P, &c, data->vpd.options->barvinok);
+    times(&en_cpu);
+    data->ticks += time_diff(&st_cpu, &en_cpu);
+    value_addto(data->total, data->total, c);
+    value_clear(c);
+
+    Polyhedron_Free(P);
+
+    return isl_stat_ok;
+}
+
+static isl_stat bench_count(__isl_take isl_point *pnt, void *user)
+{
+    struct bench_count_data *data = (struct bench_count_data *) user;
+    isl_set *set;
+    isl_stat r;
+
+    data->vpd.n--;
+
+    set = isl_set_copy(data->set);
+    set = isl_set_intersect_params(set, isl_set_from_point(pnt));
+    set = isl_set_make_disjoint(set);
+    r = isl_set_foreach_basic_set(set, &count_basic_set, data);
+    isl_set_free(set);
+
+    if (!data->vpd.options->print_all &&
+	(data->vpd.n % data->vpd.s) == 0) {
+	    printf("o");
+	    fflush(stdout);
+    }
+
+    if (r < 0)
+	return isl_stat_error;
+    return (data->vpd.n >= 1) ? isl_stat_ok : isl_stat_error;
+}
+
+static int handle(isl_ctx *ctx, FILE *in, struct bench_count_data *data,
+	struct verify_options *options)
+{
+    int r;
+    int nparam;
+    isl_set *set;
+    isl_set *context;
+
+    set = isl_set_read_from_file(ctx, in);
+    context = isl_set_read_from_file(ctx, in);
+
+    context = isl_set_move_dims(context, isl_dim_param, 0, isl_dim_set, 0,
+				isl_set_dim(context, isl_dim_set));
+    context = isl_set_params(context);
+    nparam = isl_set_dim(context, isl_dim_param);
+    if (nparam != isl_set_dim(set, isl_dim_param)) {
+	    int dim = isl_set_dim(set, isl_dim_set);
+	    set = isl_set_move_dims(set, isl_dim_param, 0,
+					isl_dim_set, dim - nparam, nparam);
+    }
+
+    set = isl_set_intersect_params(set, context);
+    context = isl_set_params(isl_set_copy(set));
+    context = verify_context_set_bounds(context, options);
+
+    data->vpd.options = options;
+    data->set = set;
+    r = verify_point_data_init(&data->vpd, context);
+    if (r == 0)
+	isl_set_foreach_point(context, &bench_count, data);
+    if (data->vpd.error)
+	r = -1;
+    verify_point_data_fini(&data->vpd);
+
+    isl_set_free(context);
+    isl_set_free(set);
+
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    isl_ctx *ctx;
+    char path[PATH_MAX+1];
+    Value total;
+    my_clock_t ticks = 0;
+    int r = EXIT_SUCCESS;
+    struct options *options = options_new_with_defaults();
+
+    argc = options_parse(options, argc, argv, ISL_ARG_ALL);
+    ctx = isl_ctx_alloc_with_options(&options_args, options);
+
+    if (options->verify->M == INT_MIN)
+	options->verify->M = 10;
+    if (options->verify->m == INT_MAX)
+	options->verify->m = -10;
+
+    value_init(total);
+    while (fgets(path, sizeof(path), stdin)) {
+	struct bench_count_data data;
+	FILE *in;
+
+	*strchr(path, '\n') = '\0';
+	fprintf(stderr, "%s\n", path);
+	in = fopen(path, "r");
+	assert(in);
+	memset(&data, 0, sizeof(data));
+	value_init(data.total);
+	if (handle(ctx, in, &data, options->verify) < 0)
+	    r = EXIT_FAILURE;
+	fclose(in);
+
+	if (!options->quiet) {
+	    fprintf(stderr, "points: ");
+	    value_print(stderr, VALUE_FMT, data.total);
+	    fprintf(stderr, ", ticks: %ld\n", (long) data.ticks);
+	}
+	value_addto(total, total, data.total);
+	ticks += data.ticks;
+	value_clear(data.total);
+    }
+
+    fprintf(stderr, "total points: ");
+    value_print(stderr, VALUE_FMT, total);
+    fprintf(stderr, ", total ticks: %ld\n", (long) ticks);
+    if (options->verify->barvinok->print_stats)
+	barvinok_stats_print(options->verify->barvinok->stats, stderr);
+    value_clear(total);
+
+    isl_ctx_free(ctx);
+
+    return r;
+}
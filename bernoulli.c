@@ -6,83 +6,130 @@
 #include "lattice_point.h"
 #include "section_array.h"
 #include "summate.h"
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #define ALLOC(type) (type*)malloc(sizeof(type))
 #define ALLOCN(type,n) (type*)malloc((n) * sizeof(type))
 
-static struct bernoulli_coef bernoulli_coef;
-static struct poly_list bernoulli;
-static struct poly_list faulhaber;
+/* The Bernoulli coefficients and the Bernoulli and Faulhaber polynomials
+ * are computed on demand and cached for the lifetime of the process.
+ * Since they may be requested from several threads at the same time
+ * (see parallel.cc), the caches are protected by a lock.
+ * A structure that has been returned is never modified, except for
+ * appending entries beyond those that have been requested, so that
+ * it can be used without holding the lock.
+ * When a cache needs to grow beyond its size, a new structure
+ * is therefore created and the old one is kept around in its prev field
+ * until bernoulli_free_caches is called.
+ */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t bernoulli_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-struct bernoulli_coef *bernoulli_coef_compute(int n)
+static void bernoulli_lock(void)
+{
+    pthread_mutex_lock(&bernoulli_mutex);
+}
+
+static void bernoulli_unlock(void)
+{
+    pthread_mutex_unlock(&bernoulli_mutex);
+}
+#else
+static void bernoulli_lock(void)
+{
+}
+
+static void bernoulli_unlock(void)
+{
+}
+#endif
+
+static struct bernoulli_coef *bernoulli_coef;
+static struct poly_list *bernoulli;
+static struct poly_list *faulhaber;
+
+static Vector *extend_vector(Vector *v, int n, int size)
+{
+    Vector *b;
+
+    b = Vector_Alloc(size);
+    if (n)
+	Vector_Copy(v->p, b->p, n);
+    return b;
+}
+
+/* Return a structure containing at least n+1 Bernoulli coefficients.
+ * The caller is assumed to hold the lock.
+ */
+static struct bernoulli_coef *bernoulli_coef_compute_locked(int n)
 {
     int i, j;
     Value factor, tmp;
+    struct bernoulli_coef *bc = bernoulli_coef;
 
-    if (n < bernoulli_coef.n)
-	return &bernoulli_coef;
+    if (bc && n < bc->n)
+	return bc;
 
-    if (n >= bernoulli_coef.size) {
+    if (!bc || n >= bc->size) {
 	int size = 3*(n + 5)/2;
-	Vector *b;
-
-	b = Vector_Alloc(size);
-	if (bernoulli_coef.n) {
-	    Vector_Copy(bernoulli_coef.num->p, b->p, bernoulli_coef.n);
-	    Vector_Free(bernoulli_coef.num);
-	}
-	bernoulli_coef.num = b;
-	b = Vector_Alloc(size);
-	if (bernoulli_coef.n) {
-	    Vector_Copy(bernoulli_coef.den->p, b->p, bernoulli_coef.n);
-	    Vector_Free(bernoulli_coef.den);
-	}
-	bernoulli_coef.den = b;
-	b = Vector_Alloc(size);
-	if (bernoulli_coef.n) {
-	    Vector_Copy(bernoulli_coef.lcm->p, b->p, bernoulli_coef.n);
-	    Vector_Free(bernoulli_coef.lcm);
-	}
-	bernoulli_coef.lcm = b;
-
-	bernoulli_coef.size = size;
+	struct bernoulli_coef *old = bc;
+
+	bc = ALLOC(struct bernoulli_coef);
+	bc->n = old ? old->n : 0;
+	bc->num = extend_vector(old ? old->num : NULL, bc->n, size);
+	bc->den = extend_vector(old ? old->den : NULL, bc->n, size);
+	bc->lcm = extend_vector(old ? old->lcm : NULL, bc->n, size);
+	bc->size = size;
+	bc->prev = old;
     }
     value_init(factor);
     value_init(tmp);
-    for (i = bernoulli_coef.n; i <= n; ++i) {
+    for (i = bc->n; i <= n; ++i) {
 	if (i == 0) {
-	    value_set_si(bernoulli_coef.num->p[0], 1);
-	    value_set_si(bernoulli_coef.den->p[0], 1);
-	    value_set_si(bernoulli_coef.lcm->p[0], 1);
+	    value_set_si(bc->num->p[0], 1);
+	    value_set_si(bc->den->p[0], 1);
+	    value_set_si(bc->lcm->p[0], 1);
 	    continue;
 	}
-	value_set_si(bernoulli_coef.num->p[i], 0);
+	value_set_si(bc->num->p[i], 0);
 	value_set_si(factor, -(i+1));
 	for (j = i-1; j >= 0; --j) {
 	    mpz_mul_ui(factor, factor, j+1);
 	    mpz_divexact_ui(factor, factor, i+1-j);
-	    value_division(tmp, bernoulli_coef.lcm->p[i-1],
-			   bernoulli_coef.den->p[j]);
-	    value_multiply(tmp, tmp, bernoulli_coef.num->p[j]);
+	    value_division(tmp, bc->lcm->p[i-1], bc->den->p[j]);
+	    value_multiply(tmp, tmp, bc->num->p[j]);
 	    value_multiply(tmp, tmp, factor);
-	    value_addto(bernoulli_coef.num->p[i], bernoulli_coef.num->p[i], tmp);
+	    value_addto(bc->num->p[i], bc->num->p[i], tmp);
 	}
-	mpz_mul_ui(bernoulli_coef.den->p[i], bernoulli_coef.lcm->p[i-1], i+1);
-	value_gcd(tmp, bernoulli_coef.num->p[i], bernoulli_coef.den->p[i]);
+	mpz_mul_ui(bc->den->p[i], bc->lcm->p[i-1], i+1);
+	value_gcd(tmp, bc->num->p[i], bc->den->p[i]);
 	if (value_notone_p(tmp)) {
-	    value_division(bernoulli_coef.num->p[i],
-			    bernoulli_coef.num->p[i], tmp);
-	    value_division(bernoulli_coef.den->p[i],
-			    bernoulli_coef.den->p[i], tmp);
+	    value_division(bc->num->p[i], bc->num->p[i], tmp);
+	    value_division(bc->den->p[i], bc->den->p[i], tmp);
 	}
-	value_lcm(bernoulli_coef.lcm->p[i],
-		  bernoulli_coef.lcm->p[i-1], bernoulli_coef.den->p[i]);
+	value_lcm(bc->lcm->p[i], bc->lcm->p[i-1], bc->den->p[i]);
     }
-    bernoulli_coef.n = n+1;
+    bc->n = n+1;
     value_clear(factor);
     value_clear(tmp);
 
-    return &bernoulli_coef;
+    bernoulli_coef = bc;
+    return bc;
+}
+
+struct bernoulli_coef *bernoulli_coef_compute(int n)
+{
+    struct bernoulli_coef *bc;
+
+    bernoulli_lock();
+    bc = bernoulli_coef_compute_locked(n);
+    bernoulli_unlock();
+
+    return bc;
 }
 
 /*
@@ -90,31 +137,38 @@ struct bernoulli_coef *bernoulli_coef_compute(int n)
  *
  * B_n =         sum_{k=0}^n {  n  \choose k } b_k x^{n-k}
  * F_n = 1/(n+1) sum_{k=0}^n { n+1 \choose k } b_k x^{n+1-k}
+ *
+ * The polynomials are cached in *cache.
  */
-static struct poly_list *bernoulli_faulhaber_compute(int n, struct poly_list *pl,
-						     int faulhaber)
+static struct poly_list *bernoulli_faulhaber_compute(int n,
+				struct poly_list **cache, int faulhaber)
 {
     int i, j;
     Value factor;
     struct bernoulli_coef *bc;
+    struct poly_list *pl;
 
-    if (n < pl->n)
+    bernoulli_lock();
+    pl = *cache;
+    if (pl && n < pl->n) {
+	bernoulli_unlock();
 	return pl;
+    }
 
-    if (n >= pl->size) {
+    if (!pl || n >= pl->size) {
 	int size = 3*(n + 5)/2;
-	Vector **poly;
+	struct poly_list *old = pl;
 
-	poly = ALLOCN(Vector *, size);
+	pl = ALLOC(struct poly_list);
+	pl->n = old ? old->n : 0;
+	pl->poly = ALLOCN(Vector *, size);
 	for (i = 0; i < pl->n; ++i)
-	    poly[i] = pl->poly[i];
-	free(pl->poly);
-	pl->poly = poly;
-
+	    pl->poly[i] = old->poly[i];
 	pl->size = size;
+	pl->prev = old;
     }
 
-    bc = bernoulli_coef_compute(n);
+    bc = bernoulli_coef_compute_locked(n);
 
     value_init(factor);
     for (i = pl->n; i <= n; ++i) {
@@ -140,6 +194,9 @@ static struct poly_list *bernoulli_faulhaber_compute(int n, struct poly_list *pl
     value_clear(factor);
     pl->n = n+1;
 
+    *cache = pl;
+    bernoulli_unlock();
+
     return pl;
 }
 
@@ -153,6 +210,43 @@ struct poly_list *faulhaber_compute(int n)
     return bernoulli_faulhaber_compute(n, &faulhaber, 1);
 }
 
+/* The polynomials are shared by all versions of the list
+ * and are therefore only freed along with the most recent one.
+ */
+static void poly_list_free(struct poly_list *pl)
+{
+    int i;
+
+    if (!pl)
+	return;
+    for (i = 0; i < pl->n; ++i)
+	Vector_Free(pl->poly[i]);
+    while (pl) {
+	struct poly_list *prev = pl->prev;
+	free(pl->poly);
+	free(pl);
+	pl = prev;
+    }
+}
+
+void bernoulli_free_caches(void)
+{
+    bernoulli_lock();
+    while (bernoulli_coef) {
+	struct bernoulli_coef *prev = bernoulli_coef->prev;
+	Vector_Free(bernoulli_coef->num);
+	Vector_Free(bernoulli_coef->den);
+	Vector_Free(bernoulli_coef->lcm);
+	free(bernoulli_coef);
+	bernoulli_coef = prev;
+    }
+    poly_list_free(bernoulli);
+    bernoulli = NULL;
+    poly_list_free(faulhaber);
+    faulhaber = NULL;
+    bernoulli_unlock();
+}
+
 static evalue *shifted_copy(const evalue *src)
 {
     evalue *e = ALLOC(evalue);
@@ -13,12 +13,14 @@ struct bernoulli_coef {
     Vector  *lcm;	/* lcm of this and previous denominators */
     int	    size;
     int	    n;		/* The number of Bernoulli coefficients */
+    struct bernoulli_coef *prev;	/* smaller version, kept for readers */
 };
 
 struct poly_list {
     Vector  **poly;
     int	    size;
     int	    n;		/* The number of polynomials */
+    struct poly_list *prev;	/* smaller version, kept for readers */
 };
 
 /*
@@ -39,6 +41,13 @@ struct poly_list *faulhaber_compute(int n);
  */
 struct poly_list *bernoulli_compute(int n);
 
+/*
+ * Free the cached Bernoulli coefficients and polynomials,
+ * including any structures that were returned before.
+ * No other thread may be using them.
+ */
+void bernoulli_free_caches(void);
+
 evalue *bernoulli_summate(Polyhedron *P, evalue *E, unsigned nvar,
 				 struct evalue_section_array *sections,
 				 struct barvinok_options *options);
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <algorithm>
 #include <vector>
 #include <ostream>
 #include <iostream>
@@ -7,25 +8,72 @@
 #include <barvinok/polylib.h>
 #include "bfcounter.h"
 #include "lattice_point.h"
+#include "vector_int_hash_map.h"
+#include "config.h"
 
 using std::vector;
 using std::cerr;
 using std::endl;
 
-static int lex_cmp(vec_ZZ& a, vec_ZZ& b)
+void bfc_terms::SetDims(int n, int len)
 {
-    assert(a.length() == b.length());
+    assert(this->n == 0 || this->len == len);
+    this->n = n;
+    this->len = len;
+    data.SetLength(n * len);
+}
 
-    for (int j = 0; j < a.length(); ++j)
+void bfc_terms::get(int i, vec_ZZ& row) const
+{
+    row.SetLength(len);
+    for (int j = 0; j < len; ++j)
+	row[j] = (*this)[i][j];
+}
+
+void bfc_terms::set(int i, const vec_ZZ& row)
+{
+    assert(row.length() == len);
+    for (int j = 0; j < len; ++j)
+	(*this)[i][j] = row[j];
+}
+
+/* Insert row at position i, moving the later rows up by one.
+ * The elements are swapped rather than copied.
+ */
+void bfc_terms::insert(int i, const vec_ZZ& row)
+{
+    SetDims(n+1, row.length());
+    for (int k = n-1; k > i; --k)
+	for (int j = 0; j < len; ++j)
+	    swap((*this)[k][j], (*this)[k-1][j]);
+    set(i, row);
+}
+
+std::ostream& operator<<(std::ostream& os, const bfc_terms& terms)
+{
+    vec_ZZ row;
+
+    os << "[";
+    for (int i = 0; i < terms.NumRows(); ++i) {
+	terms.get(i, row);
+	os << row;
+    }
+    os << "]";
+    return os;
+}
+
+static int lex_cmp(const ZZ *a, vec_ZZ& b)
+{
+    for (int j = 0; j < b.length(); ++j)
 	if (a[j] != b[j])
 	    return a[j] < b[j] ? -1 : 1;
     return 0;
 }
 
-void bf_base::add_term(bfc_term_base *t, vec_ZZ& num_orig, vec_ZZ& extra_num)
+void bf_base::add_term(bfc_term_base *t, const ZZ *num_orig, vec_ZZ& extra_num)
 {
     vec_ZZ num;
-    int d = num_orig.length();
+    int d = extra_num.length() + 1;
     num.SetLength(d-1);
     for (int l = 0; l < d-1; ++l)
 	num[l] = num_orig[l+1] + extra_num[l];
@@ -33,46 +81,82 @@ void bf_base::add_term(bfc_term_base *t, vec_ZZ& num_orig, vec_ZZ& extra_num)
     add_term(t, num);
 }
 
+/* The terms of t are kept in lexicographic order,
+ * so we can look for num using binary search.
+ */
 void bf_base::add_term(bfc_term_base *t, vec_ZZ& num)
 {
-    int len = t->terms.NumRows();
-    int i, r;
-    for (i = 0; i < len; ++i) {
-	r = lex_cmp(t->terms[i], num);
-	if (r >= 0)
-	    break;
-    }
-    if (i == len || r > 0) {
-	t->terms.SetDims(len+1, num.length());
-	insert_term(t, i);
-	t->terms[i] = num;
-    } else {
-	// i < len && r == 0
-	update_term(t, i);
+    int lo = 0, hi = t->terms.NumRows();
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+	int r = lex_cmp(t->terms[mid], num);
+	if (r == 0) {
+	    update_term(t, mid);
+	    return;
+	}
+	if (r < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
     }
+    t->terms.insert(lo, num);
+    insert_term(t, lo);
 }
 
-bfc_term_base* bf_base::find_bfc_term(bfc_vec& v, int *powers, int len)
+struct bfc_index {
+    HASH_MAP<vector<int>, bfc_term_base *> map;
+};
+
+bf_reducer::~bf_reducer()
 {
-    bfc_vec::iterator i;
-    for (i = v.begin(); i != v.end(); ++i) {
-	int j;
-	for (j = 0; j < len; ++j)
-	    if ((*i)->powers[j] != powers[j])
-		break;
-	if (j == len)
-	    return (*i);
-	if ((*i)->powers[j] > powers[j])
-	    break;
-    }
+    delete [] old2new;
+    delete [] sign;
+    delete [] npowers;
+    delete [] bpowers;
+    delete vn_index;
+}
+
+/* Return the element of vn with the given powers,
+ * creating a new element if there is no such element yet.
+ * New elements are appended to vn.  The lexicographic order
+ * on the powers is restored by sort_terms.
+ */
+bfc_term_base* bf_reducer::find_bfc_term(int *powers)
+{
+    if (!vn_index)
+	vn_index = new bfc_index;
 
-    bfc_term_base* t = new_bf_term(len);
-    v.insert(i, t);
-    memcpy(t->powers, powers, len * sizeof(int));
+    vector<int> key(powers, powers + nnf);
+    HASH_MAP<vector<int>, bfc_term_base *>::iterator i;
+    i = vn_index->map.find(key);
+    if (i != vn_index->map.end())
+	return i->second;
+
+    bfc_term_base* t = bf->new_bf_term(nnf);
+    memcpy(t->powers, powers, nnf * sizeof(int));
+    vn.push_back(t);
+    vn_index->map[key] = t;
 
     return t;
 }
 
+struct bfc_term_powers_lex_smaller {
+    int len;
+
+    bfc_term_powers_lex_smaller(int len) : len(len) {}
+    bool operator()(const bfc_term_base *t1, const bfc_term_base *t2) const {
+	for (int j = 0; j < len; ++j)
+	    if (t1->powers[j] != t2->powers[j])
+		return t1->powers[j] < t2->powers[j];
+	return false;
+    }
+};
+
+void bf_reducer::sort_terms()
+{
+    std::sort(vn.begin(), vn.end(), bfc_term_powers_lex_smaller(nnf));
+}
+
 void bf_base::reduce(mat_ZZ& factors, bfc_vec& v, barvinok_options *options)
 {
     assert(v.size() > 0);
@@ -84,6 +168,7 @@ void bf_base::reduce(mat_ZZ& factors, bfc_vec& v, barvinok_options *options)
     bf_reducer bfr(factors, v, this);
 
     bfr.reduce(options);
+    bfr.sort_terms();
 
     if (bfr.vn.size() > 0)
 	reduce(bfr.nfactors, bfr.vn, options);
@@ -108,7 +193,8 @@ int bf_base::setup_factors(const mat_ZZ& rays, mat_ZZ& factors,
 	if (factors[r][k] < 0) {
 	    factors[r] = -factors[r];
 	    for (int i = 0; i < t->terms.NumRows(); ++i)
-		t->terms[i] += factors[r];
+		for (int j = 0; j < dim; ++j)
+		    t->terms[i][j] += factors[r][j];
 	    s = -s;
 	}
     }
@@ -125,9 +211,13 @@ void bf_base::handle(const mat_ZZ& rays, Value *vertex, const QQ& c,
 
     Matrix *points = Matrix_Alloc(det, dim);
     Matrix* Rays = zz2matrix(rays);
-    lattice_points_fixed(vertex, vertex, Rays, Rays, points, det);
+    lattice_points_fixed(vertex, vertex, Rays, Rays, points, det, closed,
+			 &points_cache);
     Matrix_Free(Rays);
-    matrix2zz(points, t->terms, points->NbRows, points->NbColumns);
+    t->terms.SetDims(points->NbRows, points->NbColumns);
+    for (int i = 0; i < points->NbRows; ++i)
+	for (int j = 0; j < points->NbColumns; ++j)
+	    value2zz(points->p[i][j], t->terms[i][j]);
     Matrix_Free(points);
 
     // the elements of factors are always lexpositive
@@ -185,10 +275,8 @@ void bfcounter_base::insert_term(bfc_term_base *t, int i)
     int len = t->terms.NumRows()-1;	// already increased by one
 
     bfct->c.SetLength(len+1);
-    for (int j = len; j > i; --j) {
+    for (int j = len; j > i; --j)
 	bfct->c[j] = bfct->c[j-1];
-	t->terms[j] = t->terms[j-1];
-    }
     bfct->c[i] = c;
 }
 
@@ -319,7 +407,7 @@ void bf_reducer::reduce(barvinok_options *options)
 		}
 	    }
 
-	    bfc_term_base * t = bf->find_bfc_term(vn, npowers, nnf);
+	    bfc_term_base * t = find_bfc_term(npowers);
 	    for (int k = 0; k < v[i]->terms.NumRows(); ++k) {
 		bf->set_factor(v[i], k, changes % 2);
 		bf->add_term(t, v[i]->terms[k], extra_num);
@@ -373,7 +461,7 @@ void bf_reducer::reduce(barvinok_options *options)
 			continue;
 
 		    if (!t)
-			 t = bf->find_bfc_term(vn, bpowers, nnf);
+			 t = find_bfc_term(bpowers);
 		    bf->set_factor(v[i], k, bf->tcount, changes % 2);
 		    bf->add_term(t, v[i]->terms[k], extra_num);
 		}
@@ -419,16 +507,18 @@ void bf_reducer::reduce(barvinok_options *options)
 
 		    if (bf->constant_vertex(d)) {
 			dpoly_r_term_list& final = rc->c[rc->len-1];
+			vector<int> powers;
 
-			dpoly_r_term_list::iterator k;
-			for (k = final.begin(); k != final.end(); ++k) {
-			    if ((*k)->coeff == 0)
+			for (int k = 0; k < final.size(); ++k) {
+			    if (final.coeff(k) == 0)
 				continue;
 
-			    update_powers((*k)->powers);
+			    powers.assign(final.powers(k),
+					  final.powers(k) + rc->dim);
+			    update_powers(powers);
 
-			    bfc_term_base * t = bf->find_bfc_term(vn, npowers, nnf);
-			    factor.n = (*k)->coeff;
+			    bfc_term_base * t = find_bfc_term(npowers);
+			    factor.n = final.coeff(k);
 			    bf->set_factor(v[i], j, factor, l_changes % 2);
 			    bf->add_term(t, v[i]->terms[j], l_extra_num);
 			}
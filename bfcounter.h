@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <iostream>
 #include <vector>
 #include <gmp.h>
 #include <NTL/vec_ZZ.h>
@@ -7,10 +8,34 @@
 #include <barvinok/NTL_QQ.h>
 #include "reducer.h"
 
+/* The numerators of a bfc_term, stored row by row in a single vector,
+ * such that adding a numerator does not require the allocation
+ * of a separate vector.
+ * A row is accessed through a pointer to its first element.
+ */
+struct bfc_terms {
+    vec_ZZ  data;
+    int	    n;
+    int	    len;
+
+    bfc_terms() : n(0), len(0) {}
+
+    int NumRows() const { return n; }
+    int NumCols() const { return len; }
+    void SetDims(int n, int len);
+    ZZ *operator[](int i) { return data.elts() + i * len; }
+    const ZZ *operator[](int i) const { return data.elts() + i * len; }
+    void get(int i, vec_ZZ& row) const;
+    void set(int i, const vec_ZZ& row);
+    void insert(int i, const vec_ZZ& row);
+};
+
+std::ostream& operator<<(std::ostream& os, const bfc_terms& terms);
+
 struct bfc_term_base {
     // the number of times a given factor appears in the denominator
     int	    *powers;
-    mat_ZZ   terms;
+    bfc_terms terms;
 
     bfc_term_base(int len) {
 	powers = new int[len];
@@ -30,6 +55,7 @@ struct bfc_term : public bfc_term_base {
 typedef std::vector< bfc_term_base * > bfc_vec;
 
 struct bf_reducer;
+struct bfc_index;
 
 struct bf_base : public np_base {
     mpq_t tcount;
@@ -53,8 +79,7 @@ struct bf_base : public np_base {
 			unsigned long det, barvinok_options *options);
     int setup_factors(const mat_ZZ& rays, mat_ZZ& factors, bfc_term_base* t, int s);
 
-    bfc_term_base* find_bfc_term(bfc_vec& v, int *powers, int len);
-    void add_term(bfc_term_base *t, vec_ZZ& num1, vec_ZZ& num);
+    void add_term(bfc_term_base *t, const ZZ *num1, vec_ZZ& num);
     void add_term(bfc_term_base *t, vec_ZZ& num);
 
     void reduce(mat_ZZ& factors, bfc_vec& v, barvinok_options *options);
@@ -105,6 +130,8 @@ struct bf_reducer {
     int *sign;
     unsigned int nnf;
     bfc_vec vn;
+    // index of the elements of vn on their powers
+    bfc_index *vn_index;
 
     vec_ZZ extra_num;
     int changes;
@@ -120,7 +147,7 @@ struct bf_reducer {
     int l_changes;
 
     bf_reducer(mat_ZZ& factors, bfc_vec& v, bf_base *bf) 
-	    : factors(factors), v(v), bf(bf) {
+	    : factors(factors), v(v), bf(bf), vn_index(NULL) {
 	nf = factors.NumRows();
 	d = factors.NumCols();
 	old2new = new int[nf];
@@ -128,12 +155,10 @@ struct bf_reducer {
 
 	extra_num.SetLength(d-1);
     }
-    ~bf_reducer() {
-	delete [] old2new;
-	delete [] sign;
-	delete [] npowers;
-	delete [] bpowers;
-    }
+    ~bf_reducer();
+
+    bfc_term_base* find_bfc_term(int *powers);
+    void sort_terms();
 
     void compute_reduced_factors();
     void compute_extra_num(int i);
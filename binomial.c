@@ -1,4 +1,38 @@
 #include "binomial.h"
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/* The binomial coefficients and factorials are computed on demand
+ * and cached for the lifetime of the process.
+ * Since they may be requested from several threads at the same time
+ * (see parallel.cc), the caches are protected by a lock.
+ * The values themselves are never moved once they have been computed,
+ * such that the returned pointers remain valid while the caches grow.
+ */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void cache_lock(void)
+{
+    pthread_mutex_lock(&cache_mutex);
+}
+
+static void cache_unlock(void)
+{
+    pthread_mutex_unlock(&cache_mutex);
+}
+#else
+static void cache_lock(void)
+{
+}
+
+static void cache_unlock(void)
+{
+}
+#endif
 
 struct binom {
     Vector	**binom;
@@ -10,9 +44,14 @@ static struct binom binom;
 Value *binomial(unsigned n, unsigned k)
 {
     int i, j;
+    Value *b;
 
-    if (n < binom.n)
-	return &binom.binom[n]->p[k];
+    cache_lock();
+    if (n < binom.n) {
+	b = &binom.binom[n]->p[k];
+	cache_unlock();
+	return b;
+    }
 
     if (n >= binom.size) {
 	int size = 3*(n + 5)/2;
@@ -33,11 +72,16 @@ Value *binomial(unsigned n, unsigned k)
 	}
     }
     binom.n = n+1;
-    return &binom.binom[n]->p[k];
+    b = &binom.binom[n]->p[k];
+    cache_unlock();
+    return b;
 }
 
+/* Each factorial is allocated separately such that it does not move
+ * when the array of pointers is reallocated.
+ */
 struct fact {
-    Value 	*fact;
+    Value 	**fact;
     unsigned	size;
     unsigned	n;
 };
@@ -46,23 +90,31 @@ static struct fact fact;
 Value *factorial(unsigned n)
 {
     int i;
+    Value *f;
 
-    if (n < fact.n)
-	return &fact.fact[n];
+    cache_lock();
+    if (n < fact.n) {
+	f = fact.fact[n];
+	cache_unlock();
+	return f;
+    }
 
     if (n >= fact.size) {
 	int size = 3*(n + 5)/2;
 
-	fact.fact = (Value *)realloc(fact.fact, size*sizeof(Value));
+	fact.fact = (Value **)realloc(fact.fact, size*sizeof(Value *));
 	fact.size = size;
     }
     for (i = fact.n; i <= n; ++i) {
-	value_init(fact.fact[i]);
+	fact.fact[i] = (Value *)malloc(sizeof(Value));
+	value_init(*fact.fact[i]);
 	if (!i)
-	    value_set_si(fact.fact[0], 1);
+	    value_set_si(*fact.fact[0], 1);
 	else
-	    mpz_mul_ui(fact.fact[i], fact.fact[i-1], i);
+	    mpz_mul_ui(*fact.fact[i], *fact.fact[i-1], i);
     }
     fact.n = n+1;
-    return &fact.fact[n];
+    f = fact.fact[n];
+    cache_unlock();
+    return f;
 }
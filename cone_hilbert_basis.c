@@ -12,10 +12,16 @@ int main(int argc, char **argv)
     C = Constraints2Polyhedron(M, options->MaxRays);
     Matrix_Free(M);
 
-    M = Cone_Hilbert_Basis(C, options->MaxRays);
+    M = Cone_Hilbert_Basis(C, options);
 
     Polyhedron_Free(C);
 
+    if (!M) {
+	fprintf(stderr, "coefficients too large\n");
+	barvinok_options_free(options);
+	return 1;
+    }
+
     Matrix_Print(stdout, P_VALUE_FMT, M);
     Matrix_Free(M);
 
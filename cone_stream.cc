@@ -0,0 +1,563 @@
+#include <assert.h>
+#include <deque>
+#include <exception>
+#include <vector>
+#include <NTL/ZZ.h>
+#include <NTL/mat_ZZ.h>
+#include <barvinok/options.h>
+#include "conversion.h"
+#include "cone_stream.h"
+#include "decomposer.h"
+#include "parallel.h"
+#include "reducer.h"
+#include "config.h"
+
+#if defined(HAVE_PTHREAD) && defined(NTL_THREADS) && \
+    defined(HAVE_THREAD_SAFE_POLYLIB)
+#define USE_CONE_PIPELINE
+#include <pthread.h>
+#endif
+
+using std::vector;
+
+/* The cones resulting from a decomposition can be passed on
+ * to the consumer in two additional ways.
+ *
+ * If options->threads is larger than one and a thread is still
+ * available (see parallel.cc), then the decomposition
+ * and the consumer run in separate threads, connected by
+ * a queue of at most options->cone_queue cones.
+ * Since the consumer typically uses NTL and PolyLib, this requires NTL
+ * to be compiled with NTL_THREADS and a thread-safe PolyLib.
+ *
+ * If options->save_cones is set, then the cones are also written
+ * to a binary file that can be read back in by a later run with
+ * options->load_cones set, possibly using a different consumer.
+ * Each decomposition is stored in a block that starts with the rays
+ * of the decomposed cone.  When reading back, the block corresponding
+ * to a cone is looked up based on these rays, so the cones need
+ * not be decomposed in the same order (e.g., because a counter had
+ * to restart with a different random vector).
+ * The options that influence the decomposition itself should be
+ * the same in both runs.
+ */
+
+struct cone_record {
+    Polyhedron *C;
+    mat_ZZ rays;
+    int sign;
+    unsigned long det;
+    vector<int> closed;
+
+    cone_record(const signed_cone& sc) :
+	    rays(sc.rays), sign(sc.sign), det(sc.det) {
+	C = sc.C ? Polyhedron_Copy(sc.C) : NULL;
+	if (sc.closed)
+	    closed.assign(sc.closed, sc.closed + rays.NumRows());
+    }
+    cone_record() : C(NULL) {}
+    ~cone_record() {
+	if (C)
+	    Polyhedron_Free(C);
+    }
+    void handle(signed_cone_consumer& scc, barvinok_options *options);
+};
+
+void cone_record::handle(signed_cone_consumer& scc, barvinok_options *options)
+{
+    const int *c = closed.empty() ? NULL : &closed[0];
+    handle_signed_cone(scc, signed_cone(C, rays, sign, det, c), options);
+}
+
+#define CONE_BLOCK_MAGIC	0x62766362L
+#define CONE_BLOCK_END		0
+#define CONE_BLOCK_ABORTED	2
+
+static void write_long(FILE *f, long v)
+{
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static bool read_long(FILE *f, long *v)
+{
+    return fread(v, sizeof(*v), 1, f) == 1;
+}
+
+static void write_zz(FILE *f, const ZZ& z)
+{
+    Value v;
+    value_init(v);
+    zz2value(z, v);
+    mpz_out_raw(f, v);
+    value_clear(v);
+}
+
+static bool read_zz(FILE *f, ZZ& z)
+{
+    Value v;
+    value_init(v);
+    bool ok = mpz_inp_raw(v, f) != 0;
+    if (ok)
+	value2zz(v, z);
+    value_clear(v);
+    return ok;
+}
+
+/* Write the header of the block containing the decomposition of C.
+ */
+static void write_header(FILE *f, Polyhedron *C)
+{
+    write_long(f, CONE_BLOCK_MAGIC);
+    write_long(f, C->NbRays);
+    write_long(f, C->Dimension+2);
+    for (int i = 0; i < C->NbRays; ++i)
+	for (int j = 0; j < C->Dimension+2; ++j)
+	    mpz_out_raw(f, C->Ray[i][j]);
+}
+
+/* Read the header of a block and check whether it corresponds to C.
+ * Return -1 if no (valid) header could be read.
+ */
+static int read_header(FILE *f, Polyhedron *C)
+{
+    long magic, n, len;
+    int match;
+    Value v;
+
+    if (!read_long(f, &magic) || magic != CONE_BLOCK_MAGIC)
+	return -1;
+    if (!read_long(f, &n) || !read_long(f, &len))
+	return -1;
+    match = n == C->NbRays && len == C->Dimension+2;
+    value_init(v);
+    for (int i = 0; i < n; ++i)
+	for (int j = 0; j < len; ++j) {
+	    if (!mpz_inp_raw(v, f)) {
+		value_clear(v);
+		return -1;
+	    }
+	    if (match && value_ne(v, C->Ray[i][j]))
+		match = 0;
+	}
+    value_clear(v);
+    return match;
+}
+
+/* A cone is stored as its sign, followed by its determinant,
+ * its dimension, its closed flags (if any) and its rays.
+ * The block is terminated by CONE_BLOCK_END in place of the sign,
+ * or by CONE_BLOCK_ABORTED if the decomposition was interrupted
+ * by an exception, in which case the block is incomplete.
+ */
+static void write_cone(FILE *f, const signed_cone& sc)
+{
+    int dim = sc.rays.NumRows();
+    write_long(f, sc.sign);
+    write_long(f, sc.det);
+    write_long(f, dim);
+    write_long(f, sc.closed != NULL);
+    if (sc.closed)
+	for (int i = 0; i < dim; ++i)
+	    write_long(f, sc.closed[i]);
+    for (int i = 0; i < dim; ++i)
+	for (int j = 0; j < dim; ++j)
+	    write_zz(f, sc.rays[i][j]);
+}
+
+/* Read a cone.
+ * Return 0 at the end of a complete block, -2 at the end
+ * of an incomplete block and -1 on error.
+ */
+static int read_cone(FILE *f, cone_record& r)
+{
+    long sign, det, dim, has_closed, c;
+
+    if (!read_long(f, &sign))
+	return -1;
+    if (sign == CONE_BLOCK_END)
+	return 0;
+    if (sign == CONE_BLOCK_ABORTED)
+	return -2;
+    if (!read_long(f, &det) || !read_long(f, &dim) ||
+	!read_long(f, &has_closed))
+	return -1;
+    r.sign = sign;
+    r.det = det;
+    r.closed.clear();
+    if (has_closed)
+	for (int i = 0; i < dim; ++i) {
+	    if (!read_long(f, &c))
+		return -1;
+	    r.closed.push_back(c);
+	}
+    r.rays.SetDims(dim, dim);
+    for (int i = 0; i < dim; ++i)
+	for (int j = 0; j < dim; ++j)
+	    if (!read_zz(f, r.rays[i][j]))
+		return -1;
+    return 1;
+}
+
+/* Skip the cones in the current block.
+ * Return the final result of read_cone.
+ */
+static int skip_block(FILE *f)
+{
+    cone_record r;
+    int res;
+
+    while ((res = read_cone(f, r)) > 0)
+	;
+    return res;
+}
+
+/* Look for a complete block corresponding to C, starting at the current
+ * position and stopping at position "end", if "end" is not negative.
+ * Return true if such a block was found, in which case
+ * the file is positioned right after its header.
+ */
+static bool find_block_until(FILE *f, Polyhedron *C, long end)
+{
+    while (end < 0 || ftell(f) < end) {
+	int match = read_header(f, C);
+	if (match < 0)
+	    return false;
+	long pos = ftell(f);
+	int res = skip_block(f);
+	if (match && res == 0) {
+	    fseek(f, pos, SEEK_SET);
+	    return true;
+	}
+	if (res == -1)
+	    return false;
+    }
+    return false;
+}
+
+/* Look for a complete block corresponding to C, starting at the current
+ * position and wrapping around to the start of the file.
+ * Incomplete blocks, left behind by a decomposition that was restarted,
+ * are ignored.
+ * Return true if such a block was found, in which case
+ * the file is positioned right after its header.
+ */
+static bool find_block(FILE *f, Polyhedron *C)
+{
+    long start = ftell(f);
+
+    if (find_block_until(f, C, -1))
+	return true;
+    clearerr(f);
+    fseek(f, 0, SEEK_SET);
+    if (find_block_until(f, C, start))
+	return true;
+    clearerr(f);
+    fseek(f, start, SEEK_SET);
+    return false;
+}
+
+/* Return the file to load the cones from or to save them to,
+ * opening it the first time.
+ * If the file cannot be opened, then an error is reported and
+ * the corresponding option is cleared such that the remaining cones
+ * are decomposed without the file.
+ */
+static FILE *cone_file(barvinok_options *options)
+{
+    char **name;
+
+    if (options->cone_file)
+	return options->cone_file;
+
+    name = options->load_cones ? &options->load_cones : &options->save_cones;
+    options->cone_file = fopen(*name, options->load_cones ? "rb" : "wb");
+    if (!options->cone_file) {
+	fprintf(stderr, "Unable to open cone file '%s'; "
+			"decomposing without it\n", *name);
+	free(*name);
+	*name = NULL;
+    }
+    return options->cone_file;
+}
+
+/* Pass the cones stored for C to scc.
+ * Return false if no decomposition of C was found in the file.
+ */
+static bool load_cones(Polyhedron *C, signed_cone_consumer& scc,
+		       barvinok_options *options)
+{
+    FILE *f = cone_file(options);
+    cone_record r;
+    int res;
+
+    if (!find_block(f, C))
+	return false;
+    while ((res = read_cone(f, r)) > 0) {
+	options->stats->base_cones++;
+	r.handle(scc, options);
+    }
+    assert(res == 0);
+    return true;
+}
+
+/* If the decomposition throws an exception, then the block
+ * is marked as incomplete by the destructor.
+ */
+struct cone_writer : public signed_cone_consumer {
+    signed_cone_consumer& scc;
+    FILE *f;
+    bool finished;
+
+    cone_writer(Polyhedron *C, signed_cone_consumer& scc,
+		barvinok_options *options) : scc(scc), finished(false) {
+	f = cone_file(options);
+	write_header(f, C);
+    }
+    ~cone_writer() {
+	if (!finished) {
+	    write_long(f, CONE_BLOCK_ABORTED);
+	    fflush(f);
+	}
+    }
+    void finish() {
+	write_long(f, CONE_BLOCK_END);
+	fflush(f);
+	finished = true;
+    }
+    virtual bool handles_open_rays() {
+	return scc.handles_open_rays();
+    }
+    virtual void handle(const signed_cone& sc, barvinok_options *options) {
+	write_cone(f, sc);
+	scc.handle(sc, options);
+    }
+};
+
+#ifdef USE_CONE_PIPELINE
+
+/* Pass the cones to scc in a separate thread.
+ * The decomposition blocks as soon as the queue is full.
+ * If scc throws an exception, then the remaining cones
+ * are dropped and the exception is rethrown in the decomposition
+ * thread at the next opportunity.
+ * Only OrthogonalException is propagated as such.
+ * As in parallel_for, the consumer thread gets a private copy of options
+ * with its own statistics, which are added to options->stats
+ * when the thread has finished.
+ */
+struct cone_pipeline : public signed_cone_consumer {
+    signed_cone_consumer& scc;
+    barvinok_options *options;
+    barvinok_options consumer_options;
+    barvinok_stats consumer_stats;
+    std::deque<cone_record *> queue;
+    unsigned long max_size;
+    bool done;
+    #define PIPELINE_OK		0
+    #define PIPELINE_ORTHOGONAL	1
+    #define PIPELINE_ERROR	2
+    int error;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+
+    cone_pipeline(signed_cone_consumer& scc, barvinok_options *options);
+    ~cone_pipeline();
+    void consume();
+    void join();
+    void rethrow();
+    void finish();
+    virtual bool handles_open_rays() {
+	return scc.handles_open_rays();
+    }
+    virtual void handle(const signed_cone& sc, barvinok_options *options);
+};
+
+static void *consume_cones(void *user)
+{
+    cone_pipeline *pipeline = (cone_pipeline *) user;
+    pipeline->consume();
+    return NULL;
+}
+
+cone_pipeline::cone_pipeline(signed_cone_consumer& scc,
+			     barvinok_options *options) :
+	scc(scc), options(options), done(false), error(PIPELINE_OK)
+{
+    max_size = options->cone_queue;
+    consumer_options = *options;
+    barvinok_stats_clear(&consumer_stats);
+    consumer_options.stats = &consumer_stats;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&not_empty, NULL);
+    pthread_cond_init(&not_full, NULL);
+    int r = pthread_create(&thread, NULL, &consume_cones, this);
+    assert(r == 0);
+}
+
+/* Stop the consumer thread (if it is still running)
+ * and drop any remaining cones.
+ * The thread reserved by stream_decompose is released.
+ */
+cone_pipeline::~cone_pipeline()
+{
+    pthread_mutex_lock(&lock);
+    if (!done) {
+	done = true;
+	if (error == PIPELINE_OK)
+	    error = PIPELINE_ERROR;
+	pthread_cond_broadcast(&not_empty);
+	pthread_mutex_unlock(&lock);
+	join();
+    } else
+	pthread_mutex_unlock(&lock);
+    for (int i = 0; i < queue.size(); ++i)
+	delete queue[i];
+    pthread_cond_destroy(&not_full);
+    pthread_cond_destroy(&not_empty);
+    pthread_mutex_destroy(&lock);
+    parallel_release_threads(1);
+}
+
+void cone_pipeline::consume()
+{
+    for (;;) {
+	pthread_mutex_lock(&lock);
+	while (queue.empty() && !done)
+	    pthread_cond_wait(&not_empty, &lock);
+	if (queue.empty()) {
+	    pthread_mutex_unlock(&lock);
+	    break;
+	}
+	cone_record *r = queue.front();
+	queue.pop_front();
+	bool skip = error != PIPELINE_OK;
+	pthread_cond_signal(&not_full);
+	pthread_mutex_unlock(&lock);
+
+	int e = PIPELINE_OK;
+	if (!skip) {
+	    try {
+		r->handle(scc, &consumer_options);
+	    } catch (OrthogonalException &) {
+		e = PIPELINE_ORTHOGONAL;
+	    } catch (...) {
+		e = PIPELINE_ERROR;
+	    }
+	}
+	delete r;
+	if (e != PIPELINE_OK) {
+	    pthread_mutex_lock(&lock);
+	    if (error == PIPELINE_OK)
+		error = e;
+	    pthread_cond_broadcast(&not_full);
+	    pthread_mutex_unlock(&lock);
+	}
+    }
+}
+
+/* Wait for the consumer thread to finish and collect its statistics.
+ */
+void cone_pipeline::join()
+{
+    pthread_join(thread, NULL);
+    barvinok_stats_merge(options->stats, &consumer_stats);
+}
+
+/* Rethrow the exception of the consumer thread.
+ * Should be called with the lock released.
+ */
+void cone_pipeline::rethrow()
+{
+    if (error == PIPELINE_ORTHOGONAL)
+	throw Orthogonal;
+    throw std::bad_exception();
+}
+
+void cone_pipeline::handle(const signed_cone& sc, barvinok_options *options)
+{
+    cone_record *r = new cone_record(sc);
+
+    pthread_mutex_lock(&lock);
+    while (queue.size() >= max_size && error == PIPELINE_OK)
+	pthread_cond_wait(&not_full, &lock);
+    if (error != PIPELINE_OK) {
+	pthread_mutex_unlock(&lock);
+	delete r;
+	rethrow();
+    }
+    queue.push_back(r);
+    pthread_cond_signal(&not_empty);
+    pthread_mutex_unlock(&lock);
+}
+
+/* Wait for the consumer thread to handle all cones.
+ */
+void cone_pipeline::finish()
+{
+    pthread_mutex_lock(&lock);
+    done = true;
+    pthread_cond_broadcast(&not_empty);
+    pthread_mutex_unlock(&lock);
+    join();
+    if (error != PIPELINE_OK)
+	rethrow();
+}
+
+#endif
+
+static bool use_pipeline(barvinok_options *options)
+{
+#ifdef USE_CONE_PIPELINE
+    return parallel_threads(options) > 1 && options->cone_queue > 0;
+#else
+    return false;
+#endif
+}
+
+bool cone_stream_needed(barvinok_options *options)
+{
+    return options->load_cones || options->save_cones ||
+	   use_pipeline(options);
+}
+
+/* Decompose C (or load its decomposition) and pass the cones to scc,
+ * as described above.
+ * Since the decomposition frees C, the cone_writer is constructed first.
+ * If no thread is available for the pipeline, then the decomposition
+ * is performed in the calling thread, saving the cones only if requested.
+ */
+void stream_decompose(Polyhedron *C, signed_cone_consumer& scc,
+		      barvinok_options *options)
+{
+    if (options->load_cones && cone_file(options)) {
+	if (load_cones(C, scc, options)) {
+	    Domain_Free(C);
+	    return;
+	}
+	decompose_cone(C, scc, options);
+	return;
+    }
+
+#ifdef USE_CONE_PIPELINE
+    if (use_pipeline(options) && parallel_reserve_threads(1, options)) {
+	cone_pipeline pipeline(scc, options);
+	if (options->save_cones && cone_file(options)) {
+	    cone_writer writer(C, pipeline, options);
+	    decompose_cone(C, writer, options);
+	    writer.finish();
+	} else
+	    decompose_cone(C, pipeline, options);
+	pipeline.finish();
+	return;
+    }
+#endif
+
+    if (options->save_cones && cone_file(options)) {
+	cone_writer writer(C, scc, options);
+	decompose_cone(C, writer, options);
+	writer.finish();
+    } else
+	decompose_cone(C, scc, options);
+}
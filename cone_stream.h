@@ -0,0 +1,14 @@
+#ifndef CONE_STREAM_H
+#define CONE_STREAM_H
+
+#include <barvinok/polylib.h>
+#include <barvinok/options.h>
+#include "decomposer.h"
+
+void decompose_cone(Polyhedron *C, signed_cone_consumer& scc,
+		    barvinok_options *options);
+bool cone_stream_needed(barvinok_options *options);
+void stream_decompose(Polyhedron *C, signed_cone_consumer& scc,
+		      barvinok_options *options);
+
+#endif
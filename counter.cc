@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include <NTL/ZZ.h>
 #include <NTL/vec_ZZ.h>
 #include <NTL/mat_ZZ.h>
@@ -27,7 +28,8 @@ void counter_base::handle(const mat_ZZ& rays, Value *V, const QQ& c,
 	    throw Orthogonal;
 	}
     Inner_Product(lambda->p, V, dim, &tmp);
-    lattice_points_fixed(V, &tmp, Rays, den, num, det);
+    lattice_points_fixed(V, &tmp, Rays, den, num, det, closed,
+			 &points_cache);
     num->NbRows = det;
     Matrix_Free(Rays);
 
@@ -60,11 +62,125 @@ static void add_falling_powers(dpoly& n, Value degree)
     value_clear(tmp);
 }
 
+static void add_powers(dpoly& n, const Value c)
+{
+    value_increment(n.coeff->p[0], n.coeff->p[0]);
+    if (n.coeff->Size == 1)
+	return;
+
+    Value tmp;
+    value_init(tmp);
+    value_assign(tmp, c);
+    value_addto(n.coeff->p[1], n.coeff->p[1], tmp);
+    for (int i = 2; i < n.coeff->Size; ++i) {
+	value_multiply(tmp, tmp, c);
+	value_addto(n.coeff->p[i], n.coeff->p[i], tmp);
+    }
+    value_clear(tmp);
+}
+
+#ifdef __SIZEOF_INT128__
+
+#define POWER_SUM_LANES	16
+
+static void value_add_int128(Value r, __int128 x)
+{
+    unsigned __int128 u = x < 0 ? -(unsigned __int128) x : x;
+    Value tmp;
+
+    value_init(tmp);
+    mpz_set_ui(tmp, (unsigned long) (u >> 64));
+    mpz_mul_2exp(tmp, tmp, 64);
+    mpz_add_ui(tmp, tmp, (unsigned long) u);
+    if (x < 0)
+	value_subtract(r, r, tmp);
+    else
+	value_addto(r, r, tmp);
+    value_clear(tmp);
+}
+
+/* Add the sums over the n values in v of the falling powers
+ * (i.e., { v \choose i }) if falling is set or of the powers v^i otherwise,
+ * for i = 0..d.coeff->Size-1, to the coefficients of d.
+ *
+ * The values are handled in blocks of POWER_SUM_LANES lanes using
+ * 64-bit integers with 128-bit intermediate products and the sums
+ * are accumulated in 128-bit integers.
+ * A lane is handled using GMP instead if its value does not fit
+ * in 62 bits or if any of its (falling) powers does not fit in 64 bits.
+ * The sums themselves cannot overflow since each term is smaller
+ * than 2^63 in absolute value.
+ */
+void add_power_sums(dpoly& d, Value *v, int n, bool falling)
+{
+    int len = d.coeff->Size;
+    __int128 *sum = new __int128[len];
+    int64_t *coeff = new int64_t[len * POWER_SUM_LANES];
+    int64_t x[POWER_SUM_LANES];
+    int big[POWER_SUM_LANES];
+
+    for (int i = 0; i < len; ++i)
+	sum[i] = 0;
+    for (int k = 0; k < n; k += POWER_SUM_LANES) {
+	int m = n - k < POWER_SUM_LANES ? n - k : POWER_SUM_LANES;
+
+	for (int l = 0; l < m; ++l) {
+	    big[l] = mpz_sizeinbase(v[k + l], 2) > 62;
+	    x[l] = big[l] ? 0 : mpz_get_si(v[k + l]);
+	    coeff[l] = 1;
+	}
+	for (int i = 1; i < len; ++i) {
+	    int64_t *prev = coeff + (i - 1) * POWER_SUM_LANES;
+	    int64_t *c = coeff + i * POWER_SUM_LANES;
+	    if (falling)
+		for (int l = 0; l < m; ++l) {
+		    __int128 p = (__int128) prev[l] * (x[l] - (i - 1)) / i;
+		    big[l] |= p > INT64_MAX || p < INT64_MIN;
+		    c[l] = (int64_t) p;
+		}
+	    else
+		for (int l = 0; l < m; ++l) {
+		    __int128 p = (__int128) prev[l] * x[l];
+		    big[l] |= p > INT64_MAX || p < INT64_MIN;
+		    c[l] = (int64_t) p;
+		}
+	}
+	for (int l = 0; l < m; ++l) {
+	    if (big[l]) {
+		if (falling)
+		    add_falling_powers(d, v[k + l]);
+		else
+		    add_powers(d, v[k + l]);
+		continue;
+	    }
+	    for (int i = 0; i < len; ++i)
+		sum[i] += coeff[i * POWER_SUM_LANES + l];
+	}
+    }
+    for (int i = 0; i < len; ++i)
+	value_add_int128(d.coeff->p[i], sum[i]);
+
+    delete [] coeff;
+    delete [] sum;
+}
+
+#else
+
+void add_power_sums(dpoly& d, Value *v, int n, bool falling)
+{
+    for (int k = 0; k < n; ++k)
+	if (falling)
+	    add_falling_powers(d, v[k]);
+	else
+	    add_powers(d, v[k]);
+}
+
+#endif
+
 void counter::add_lattice_points(int sign)
 {
     dpoly d(dim);
-    for (int k = 0; k < num->NbRows; ++k)
-	add_falling_powers(d, num->p_Init[k]);
+    add_power_sums(d, num->p_Init, num->NbRows, true);
     dpoly n(dim, den->p_Init[0], 1);
     for (int k = 1; k < dim; ++k) {
 	dpoly fact(dim, den->p_Init[k], 1);
@@ -73,6 +189,328 @@ void counter::add_lattice_points(int sign)
     d.div(n, count, sign);
 }
 
+/* Compute an upper bound on the number of integer points in the
+ * bounded polyhedron P from its bounding box.
+ */
+static void bounding_box_size(Polyhedron *P, Value *size)
+{
+    unsigned dim = P->Dimension;
+    Value min, max, tmp;
+    value_init(min);
+    value_init(max);
+    value_init(tmp);
+    value_set_si(*size, 1);
+    for (int j = 0; j < dim; ++j) {
+	bool first = true;
+	for (int i = 0; i < P->NbRays; ++i) {
+	    if (!value_pos_p(P->Ray[i][dim+1]))
+		continue;
+	    mpz_cdiv_q(tmp, P->Ray[i][1+j], P->Ray[i][dim+1]);
+	    if (first || value_lt(tmp, min))
+		value_assign(min, tmp);
+	    mpz_fdiv_q(tmp, P->Ray[i][1+j], P->Ray[i][dim+1]);
+	    if (first || value_gt(tmp, max))
+		value_assign(max, tmp);
+	    first = false;
+	}
+	value_subtract(tmp, max, min);
+	value_increment(tmp, tmp);
+	if (value_negz_p(tmp)) {
+	    value_set_si(*size, 0);
+	    break;
+	}
+	value_multiply(*size, *size, tmp);
+    }
+    value_clear(min);
+    value_clear(max);
+    value_clear(tmp);
+}
+
+/* Inverse of a modulo the prime p, with 0 < a < p. */
+static uint64_t inv_mod(uint64_t a, uint64_t p)
+{
+    int64_t r0 = p, r1 = a, s0 = 0, s1 = 1;
+    while (r1 != 0) {
+	int64_t q = r0 / r1;
+	int64_t t = r0 - q * r1;
+	r0 = r1;
+	r1 = t;
+	t = s0 - q * s1;
+	s0 = s1;
+	s1 = t;
+    }
+    assert(r0 == 1);
+    return s0 < 0 ? s0 + p : s0;
+}
+
+static bool is_prime(uint64_t p)
+{
+    if (p % 2 == 0)
+	return p == 2;
+    for (uint64_t f = 3; f * f <= p; f += 2)
+	if (p % f == 0)
+	    return false;
+    return true;
+}
+
+#define MODULAR_PRIME_BITS	31
+
+/* Select the n_primes largest primes below 2^MODULAR_PRIME_BITS
+ * and precompute the inverses of the factorials up to (dim+1)!
+ * modulo each of these primes.
+ */
+void mcounter::setup_primes(int n_primes)
+{
+    int len = dim + 1;
+
+    prime.clear();
+    for (uint64_t p = (UINT64_C(1) << MODULAR_PRIME_BITS) - 1;
+	 prime.size() < n_primes; p -= 2)
+	if (is_prime(p))
+	    prime.push_back(p);
+
+    inv_fact.resize((len + 1) * n_primes);
+    for (int j = 0; j < n_primes; ++j)
+	inv_fact[j] = 1;
+    for (int i = 1; i <= len; ++i)
+	for (int j = 0; j < n_primes; ++j)
+	    inv_fact[i * n_primes + j] =
+		inv_fact[(i - 1) * n_primes + j] * inv_mod(i, prime[j]) %
+		prime[j];
+
+    residue.resize(n_primes);
+    dead.resize(n_primes);
+    n.resize(len * n_primes);
+    d.resize(len * n_primes);
+    t.resize(len * n_primes);
+    x.resize(n_primes);
+    w.resize(n_primes);
+}
+
+/* Each prime contributes MODULAR_PRIME_BITS-1 bits to the modulus.
+ * We need 2 * bound * 2^(MODULAR_PRIME_BITS-1) to be smaller than
+ * the modulus such that the rational reconstruction is guaranteed to
+ * find the count and such that a denominator of at least
+ * 2^(MODULAR_PRIME_BITS-1) is allowed, which makes it unlikely
+ * that an incorrect result would reconstruct to an integer.
+ * A couple of extra primes are kept in reserve in case some
+ * of them divide one of the denominators.
+ */
+void mcounter::start(Polyhedron *P, barvinok_options *options)
+{
+    this->P = P;
+    this->options = options;
+
+    bounding_box_size(P, &bound);
+    int bits = mpz_sizeinbase(bound, 2) + MODULAR_PRIME_BITS;
+    needed = (bits + MODULAR_PRIME_BITS - 2) / (MODULAR_PRIME_BITS - 1);
+    setup_primes(needed + 2);
+    options->stats->modular_primes += prime.size();
+
+    np_base::start(P, options);
+}
+
+void mcounter::reset()
+{
+    counter_base::reset();
+    for (int j = 0; j < prime.size(); ++j) {
+	residue[j] = 0;
+	dead[j] = false;
+    }
+}
+
+/* Compute the binomial coefficients { v \choose i+offset } modulo
+ * each of the primes, for i = 0..dim, and store them in c.
+ */
+void mcounter::binomials(uint64_t *c, Value v, int offset)
+{
+    int np = prime.size();
+    int len = dim + 1;
+
+    for (int j = 0; j < np; ++j) {
+	x[j] = mpz_fdiv_ui(v, prime[j]);
+	w[j] = 1;
+    }
+    if (offset == 0)
+	for (int j = 0; j < np; ++j)
+	    c[j] = 1;
+    for (int m = 1; m < len + offset; ++m) {
+	uint64_t *cm = c + (m - offset) * np;
+	for (int j = 0; j < np; ++j) {
+	    uint64_t p = prime[j];
+	    w[j] = w[j] * ((x[j] + p - (m - 1)) % p) % p;
+	}
+	if (m < offset)
+	    continue;
+	for (int j = 0; j < np; ++j)
+	    cm[j] = w[j] * inv_fact[m * np + j] % prime[j];
+    }
+}
+
+/* The same computation as counter::add_lattice_points,
+ * but performed modulo each of the primes.
+ * A prime that divides the constant term of the denominator
+ * can no longer be used.
+ */
+void mcounter::add_lattice_points(int sign)
+{
+    int np = prime.size();
+    int len = dim + 1;
+
+    for (int i = 0; i < len * np; ++i)
+	n[i] = 0;
+    for (int k = 0; k < num->NbRows; ++k) {
+	binomials(&t[0], num->p_Init[k], 0);
+	for (int i = 0; i < len; ++i)
+	    for (int j = 0; j < np; ++j) {
+		uint64_t s = n[i * np + j] + t[i * np + j];
+		n[i * np + j] = s >= prime[j] ? s - prime[j] : s;
+	    }
+    }
+
+    binomials(&d[0], den->p_Init[0], 1);
+    for (int k = 1; k < dim; ++k) {
+	binomials(&t[0], den->p_Init[k], 1);
+	for (int i = len - 1; i >= 0; --i)
+	    for (int j = 0; j < np; ++j) {
+		uint64_t p = prime[j];
+		uint64_t s = 0;
+		for (int a = 0; a <= i; ++a) {
+		    s += d[a * np + j] * t[(i - a) * np + j] % p;
+		    if (s >= p)
+			s -= p;
+		}
+		d[i * np + j] = s;
+	    }
+    }
+
+    for (int j = 0; j < np; ++j) {
+	if (d[j] == 0)
+	    dead[j] = true;
+	x[j] = dead[j] ? 0 : inv_mod(d[j], prime[j]);
+    }
+    for (int i = 0; i < len; ++i)
+	for (int j = 0; j < np; ++j) {
+	    uint64_t p = prime[j];
+	    uint64_t s = n[i * np + j];
+	    for (int a = 1; a <= i; ++a)
+		s = (s + p - d[a * np + j] * t[(i - a) * np + j] % p) % p;
+	    t[i * np + j] = s * x[j] % p;
+	}
+
+    uint64_t *q = &t[(len - 1) * np];
+    for (int j = 0; j < np; ++j) {
+	uint64_t p = prime[j];
+	if (sign == -1)
+	    residue[j] = (residue[j] + p - q[j]) % p;
+	else
+	    residue[j] = (residue[j] + q[j]) % p;
+    }
+}
+
+/* Find n/d with |n| <= N and 0 < d such that n = d x modulo M,
+ * using the extended Euclidean algorithm.
+ * Return false if there is no such fraction with d <= M/(2N).
+ */
+static bool rational_reconstruction(Value x, Value M, Value N,
+				    Value n, Value d)
+{
+    Value r0, r1, s0, s1, q, tmp, D;
+    bool ok;
+
+    value_init(r0);
+    value_init(r1);
+    value_init(s0);
+    value_init(s1);
+    value_init(q);
+    value_init(tmp);
+    value_init(D);
+
+    value_assign(r0, M);
+    value_assign(r1, x);
+    value_set_si(s0, 0);
+    value_set_si(s1, 1);
+    while (value_gt(r1, N)) {
+	mpz_fdiv_qr(q, tmp, r0, r1);
+	value_assign(r0, r1);
+	value_assign(r1, tmp);
+	value_multiply(tmp, q, s1);
+	value_subtract(tmp, s0, tmp);
+	value_assign(s0, s1);
+	value_assign(s1, tmp);
+    }
+    if (value_neg_p(s1)) {
+	value_oppose(s1, s1);
+	value_oppose(r1, r1);
+    }
+    value_addto(D, N, N);
+    mpz_fdiv_q(D, M, D);
+    value_gcd(tmp, r1, s1);
+    ok = value_le(s1, D) && value_one_p(tmp);
+    value_assign(n, r1);
+    value_assign(d, s1);
+
+    value_clear(r0);
+    value_clear(r1);
+    value_clear(s0);
+    value_clear(s1);
+    value_clear(q);
+    value_clear(tmp);
+    value_clear(D);
+
+    return ok;
+}
+
+/* Combine the residues of the remaining primes using CRT and
+ * reconstruct the count.
+ */
+void mcounter::get_count(Value *result)
+{
+    int np = prime.size();
+    int alive = 0;
+    bool ok = false;
+    Value M, X, N, den;
+
+    for (int j = 0; j < np; ++j)
+	if (!dead[j])
+	    ++alive;
+
+    value_init(M);
+    value_init(X);
+    value_init(N);
+    value_init(den);
+    if (alive >= needed) {
+	value_set_si(M, 1);
+	value_set_si(X, 0);
+	for (int j = 0; j < np; ++j) {
+	    if (dead[j])
+		continue;
+	    uint64_t p = prime[j];
+	    uint64_t c = (residue[j] + p - mpz_fdiv_ui(X, p)) % p;
+	    c = c * inv_mod(mpz_fdiv_ui(M, p), p) % p;
+	    mpz_addmul_ui(X, M, c);
+	    mpz_mul_ui(M, M, p);
+	}
+	value_assign(N, bound);
+	if (value_zero_p(N))
+	    value_set_si(N, 1);
+	ok = rational_reconstruction(X, M, N, *result, den);
+	ok = ok && value_one_p(den);
+    }
+    value_clear(M);
+    value_clear(X);
+    value_clear(N);
+    value_clear(den);
+
+    if (ok)
+	return;
+
+    options->stats->modular_fallbacks++;
+    counter cnt(dim, max_index);
+    cnt.start(P, options);
+    cnt.get_count(result);
+}
+
 
 
 
@@ -104,19 +542,6 @@ void tcounter::adapt_todd(dpoly& t, const Value c)
     }
 }
 
-void tcounter::add_powers(dpoly& n, const Value c)
-{
-    value_increment(n.coeff->p[0], n.coeff->p[0]);
-    if (n.coeff->Size == 1)
-	return;
-    value_assign(tmp, c);
-    value_addto(n.coeff->p[1], n.coeff->p[1], tmp);
-    for (int i = 2; i < n.coeff->Size; ++i) {
-	value_multiply(tmp, tmp, c);
-	value_addto(n.coeff->p[i], n.coeff->p[i], tmp);
-    }
-}
-
 void tcounter::add_lattice_points(int sign)
 {
     dpoly t(todd);
@@ -130,8 +555,7 @@ void tcounter::add_lattice_points(int sign)
     }
 
     dpoly n(dim);
-    for (int k = 0; k < num->NbRows; ++k)
-	add_powers(n, num->p_Init[k]);
+    add_power_sums(n, num->p_Init, num->NbRows, false);
 
     for (int i = 0; i < n.coeff->Size; ++i)
 	value_multiply(n.coeff->p[i], n.coeff->p[i], todd_denom->p[i]);
@@ -147,13 +571,7 @@ void tcounter::add_lattice_points(int sign)
     for (int i = 1; i < n.coeff->Size; ++i)
 	value_addmul(tmp, t.coeff->p[i], n.coeff->p[n.coeff->Size-1-i]);
 
-    value_assign(mpq_numref(tcount), tmp);
-    value_assign(mpq_denref(tcount), denom);
-    mpq_canonicalize(tcount);
-    if (sign == -1)
-	mpq_sub(count, count, tcount);
-    else
-	mpq_add(count, count, tcount);
+    count.add(tmp, denom, sign);
 }
 
 
@@ -251,7 +669,7 @@ void infinite_counter::reduce(const vec_QQ& c, const mat_ZZ& num,
 	}
 	zz2value(lcm, tz);
 	value_assign(mpq_denref(factor), tz);
-	mpq_add(count[0], count[0], factor);
+	count[0].add(factor, 1);
 	mpq_clear(factor);
 	return;
     }
@@ -1,17 +1,24 @@
+#include <stdint.h>
+#include <vector>
 #include <NTL/vec_ZZ.h>
 #include <NTL/mat_ZZ.h>
 #include <barvinok/polylib.h>
 #include "reducer.h"
 
+/* Add the sums over the n values in v of the falling powers
+ * if falling is set or of the powers otherwise to the coefficients of d.
+ * The values in v may be modified.
+ */
+void add_power_sums(dpoly& d, Value *v, int n, bool falling);
+
 struct counter_base: public np_base {
     Vector *lambda;
     Matrix *den;
     Matrix *num;
-    mpq_t count;
+    rational_sum count;
     Value tmp;
 
     counter_base(unsigned dim, unsigned long max_index) : np_base(dim) {
-	mpq_init(count);
 	num = Matrix_Alloc(max_index, 1);
 	den = Matrix_Alloc(dim, 1);
 	lambda = Vector_Alloc(dim);
@@ -25,14 +32,13 @@ struct counter_base: public np_base {
     }
 
     virtual void reset() {
-	mpq_set_si(count, 0, 0);
+	count.reset();
     }
 
     ~counter_base() {
 	Matrix_Free(num);
 	Matrix_Free(den);
 	Vector_Free(lambda);
-	mpq_clear(count);
 	value_clear(tmp);
     }
 
@@ -41,8 +47,9 @@ struct counter_base: public np_base {
     virtual void handle(const mat_ZZ& rays, Value *vertex, const QQ& c,
 			unsigned long det, barvinok_options *options);
     virtual void get_count(Value *result) {
-	assert(value_one_p(&count[0]._mp_den));
-	value_assign(*result, &count[0]._mp_num);
+	count.canonicalize();
+	assert(value_one_p(mpq_denref(count.q)));
+	value_assign(*result, mpq_numref(count.q));
     }
 };
 
@@ -54,14 +61,12 @@ struct counter : public counter_base {
 };
 
 struct tcounter : public counter_base {
-    mpq_t tcount;
     dpoly todd;
     Vector *todd_denom;
     Value denom;
 
     tcounter(unsigned dim, unsigned long max_index) :
 		counter_base(dim, max_index), todd(dim) {
-	mpq_init(tcount);
 	setup_todd(dim);
 	value_init(denom);
     }
@@ -69,10 +74,8 @@ struct tcounter : public counter_base {
     void setup_todd(unsigned dim);
 
     void adapt_todd(dpoly& t, const Value c);
-    void add_powers(dpoly& n, const Value c);
 
     ~tcounter() {
-	mpq_clear(tcount);
 	Vector_Free(todd_denom);
 	value_clear(denom);
     }
@@ -80,6 +83,51 @@ struct tcounter : public counter_base {
     virtual void add_lattice_points(int sign);
 };
 
+/* A counter that performs all computations modulo a set of primes
+ * of at most 31 bits, such that products of residues fit in 64 bits.
+ * The residues are stored per coefficient and then per prime,
+ * so that the inner loops run over the primes.
+ * The final count is reconstructed from the residues using CRT
+ * and rational reconstruction, where the number of primes is determined
+ * by an upper bound on the number of integer points.
+ * If not enough primes survive (a prime is dropped if it divides
+ * one of the denominators) or if the reconstruction fails,
+ * the count is recomputed exactly.
+ */
+struct mcounter : public counter_base {
+    unsigned long max_index;
+    Polyhedron *P;
+    barvinok_options *options;
+    /* number of primes needed according to the bound */
+    int needed;
+    std::vector<uint64_t> prime;
+    std::vector<bool> dead;
+    /* inv_fact[i * n + j] is the inverse of i! modulo prime j */
+    std::vector<uint64_t> inv_fact;
+    std::vector<uint64_t> residue;
+    /* work space */
+    std::vector<uint64_t> n, d, t, x, w;
+    /* upper bound on the number of integer points */
+    Value bound;
+
+    mcounter(unsigned dim, unsigned long max_index) :
+	counter_base(dim, max_index), max_index(max_index),
+	P(NULL), options(NULL), needed(0) {
+	value_init(bound);
+    }
+    ~mcounter() {
+	value_clear(bound);
+    }
+
+    virtual void start(Polyhedron *P, barvinok_options *options);
+    virtual void reset();
+    void setup_primes(int n_primes);
+    void binomials(uint64_t *c, Value v, int offset);
+
+    virtual void add_lattice_points(int sign);
+    virtual void get_count(Value *result);
+};
+
 /* A counter for possibly infinite sets.
  * Rather than just keeping track of the constant term
  * of the Laurent expansions, we also keep track of the
@@ -91,24 +139,24 @@ struct infinite_counter {
      * the term with power -i.
      */
     vec_ZZ lambda;
-    mpq_t *count;
+    rational_sum *count;
     unsigned maxlen;
     Value tz;
 
     infinite_counter(unsigned dim, unsigned maxlen) : maxlen(maxlen) {
-	count = new mpq_t[maxlen+1];
-	for (int i = 0; i <= maxlen; ++i)
-	    mpq_init(count[i]);
+	count = new rational_sum[maxlen+1];
 	value_init(tz);
     }
 
     void init(Polyhedron *context, int n_try);
 
     void reduce(const vec_QQ& c, const mat_ZZ& num, const mat_ZZ& den_f);
+    void canonicalize() {
+	for (int i = 0; i <= maxlen; ++i)
+	    count[i].canonicalize();
+    }
 
     ~infinite_counter() {
-	for (int i = 0; i <= maxlen; ++i)
-	    mpq_clear(count[i]);
 	delete [] count;
 	value_clear(tz);
     }
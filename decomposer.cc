@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <ostream>
 #include <vector>
@@ -8,8 +10,10 @@
 #include <NTL/LLL.h>
 #include <barvinok/barvinok.h>
 #include <barvinok/util.h>
+#include "cone_stream.h"
 #include "conversion.h"
 #include "decomposer.h"
+#include "fixed_dim.h"
 #include "param_util.h"
 #include "reduce_domain.h"
 
@@ -59,6 +63,128 @@ static void normalize_matrix(mat_ZZ& B)
 	    B[i][j] /= gcd;
 }
 
+/* Maximal bit size of the entries of B */
+static long max_bits(const mat_ZZ& B)
+{
+    long bits = 0;
+    for (int i = 0; i < B.NumRows(); ++i)
+	for (int j = 0; j < B.NumCols(); ++j)
+	    if (NumBits(B[i][j]) > bits)
+		bits = NumBits(B[i][j]);
+    return bits;
+}
+
+/* Entries of this size still allow LLL_FP to compute inner products
+ * without overflowing the exponent range of a double.
+ */
+#define LLL_FP_MAX_BITS		500
+
+/* The floating point reduction routines require 1/2 < delta < 1 */
+static double fp_delta(barvinok_options *options)
+{
+    double delta = (double) options->LLL_a / options->LLL_b;
+    if (delta > 0.99)
+	delta = 0.99;
+    if (delta < 0.51)
+	delta = 0.51;
+    return delta;
+}
+
+/* Check that U is unimodular and maps B onto R */
+static bool valid_reduction(const mat_ZZ& B, const mat_ZZ& U, const mat_ZZ& R)
+{
+    return IsOne(abs(determinant(U))) && U * B == R;
+}
+
+/* Perform a floating point LLL reduction of B, returning false
+ * if the entries are too large or if the result cannot be verified.
+ * In the latter case, B is left untouched.
+ * The transformation U returned by LLL_FP is checked to be unimodular
+ * and to actually map the original B onto the reduced B.
+ */
+static bool LLL_fp(mat_ZZ& B, mat_ZZ& U, barvinok_options *options)
+{
+    long bits = max_bits(B);
+    if (bits > LLL_FP_MAX_BITS)
+	return false;
+    if (options->LLL_engine == BV_LLL_AUTO && bits > NTL_DOUBLE_PRECISION)
+	return false;
+
+    mat_ZZ R = B;
+    options->stats->lll_fp++;
+    if (LLL_FP(R, U, fp_delta(options)) != R.NumRows() ||
+	    !valid_reduction(B, U, R)) {
+	options->stats->lll_fp_fallbacks++;
+	return false;
+    }
+    B = R;
+    return true;
+}
+
+/* Returns the index of the row of B with the smallest largest
+ * absolute value.
+ */
+static int shortest_row(mat_ZZ& B)
+{
+    ZZ min = max(B[0]);
+    int index = 0;
+    for (int i = 1; i < B.NumRows(); ++i) {
+	ZZ tmp = max(B[i]);
+	if (tmp < min) {
+	    min = tmp;
+	    index = i;
+	}
+    }
+    return index;
+}
+
+/* Further reduce the LLL reduced basis B using BKZ with block size
+ * options->svp_dimension, updating the transformation U accordingly.
+ * If the dimension does not exceed this block size, then BKZ performs
+ * a complete Schnorr-Euchner enumeration and the first row of the result
+ * is a shortest vector in the lattice.
+ * Since we are actually interested in the vector with the smallest
+ * largest absolute value, the result is only accepted if it does not
+ * make this vector any longer.
+ */
+static void svp_reduce(mat_ZZ& B, mat_ZZ& U, barvinok_options *options)
+{
+    long block = B.NumRows();
+    if (block > (long) options->svp_dimension)
+	block = options->svp_dimension;
+    if (block < 2)
+	return;
+
+    ZZ before = max(B[shortest_row(B)]);
+    mat_ZZ R = B;
+    mat_ZZ U2;
+    options->stats->svp_reductions++;
+    if (max_bits(B) <= LLL_FP_MAX_BITS)
+	BKZ_FP(R, U2, fp_delta(options), block);
+    else
+	BKZ_XD(R, U2, fp_delta(options), block);
+    if (!valid_reduction(B, U2, R))
+	return;
+
+    ZZ after = max(R[shortest_row(R)]);
+    if (after > before)
+	return;
+    if (after < before)
+	options->stats->svp_shorter++;
+    B = R;
+    U = U2 * U;
+}
+
+/* Approximate number of bytes used by M */
+static size_t mat_bytes(const mat_ZZ& M)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < M.NumRows(); ++i)
+	for (int j = 0; j < M.NumCols(); ++j)
+	    bytes += sizeof(ZZ) + NumBytes(M[i][j]);
+    return bytes;
+}
+
 class cone {
 public:
     cone(const mat_ZZ& r, int row, const vec_ZZ& w, int s) {
@@ -73,25 +199,38 @@ public:
 	set_det();
     }
     void set_det() {
-	det = determinant(rays);
+	determinant_fixed(det, rays);
 	assert(!IsZero(det));
     }
+    /* Compute the (normalized) adjugate of the rays */
+    void set_B() {
+	inv_fixed(det, B, rays);
+	normalize_matrix(B);
+	if (sign(det) < 0)
+	    negate(B, B);
+    }
+    /* Drop B while the cone is waiting to be split */
+    void compact() {
+	B.kill();
+    }
+    size_t bytes() const {
+	return sizeof(*this) + mat_bytes(rays) + mat_bytes(B);
+    }
     bool needs_split(barvinok_options *options) {
 	index = abs(det);
 	if (IsOne(index))
 	    return false;
-	if (options->primal && index <= options->max_index)
+	bool primal = options->primal || options->half_open;
+	if (primal && index <= options->max_index)
 	    return false;
 
-	inv(det, B, rays);
-	normalize_matrix(B);
-	if (sign(det) < 0)
-	    negate(B, B);
+	set_B();
 
-	if (!options->primal && options->max_index > 1) {
+	if (!primal && options->max_index > 1) {
 	    mat_ZZ B2 = B;
 	    normalize_cols(B2);
-	    index = abs(determinant(B2));
+	    determinant_fixed(index, B2);
+	    index = abs(index);
 	    if (index <= options->max_index)
 		return false;
 	}
@@ -103,17 +242,16 @@ public:
 	ZZ det2;
 	mat_ZZ U;
 
-	LLL(det2, B, U, options->LLL_a, options->LLL_b);
-
-	ZZ min = max(B[0]);
-	int index = 0;
-	for (int i = 1; i < B.NumRows(); ++i) {
-	    ZZ tmp = max(B[i]);
-	    if (tmp < min) {
-		min = tmp;
-		index = i;
-	    }
+	if (B.NumRows() == 0)
+	    set_B();
+	if (options->LLL_engine == BV_LLL_EXACT || !LLL_fp(B, U, options)) {
+	    options->stats->lll_exact++;
+	    LLL(det2, B, U, options->LLL_a, options->LLL_b);
 	}
+	if (options->svp_dimension > 1)
+	    svp_reduce(B, U, options);
+
+	int index = shortest_row(B);
 
 	lambda = B[index];
 
@@ -136,6 +274,80 @@ public:
     int sgn;
 };
 
+struct larger_index {
+    bool operator()(const cone *a, const cone *b) {
+	return a->index < b->index;
+    }
+};
+
+/* The cones that still need to be split, in the order specified
+ * by options->decompose_order.
+ * If options->decompose_memory is set, then the cones are stored
+ * without their adjugate and as soon as the total size of the pending
+ * cones would exceed this limit, any further cones are put on
+ * an overflow stack, which is handled in depth first order
+ * before any of the other cones.
+ */
+struct pending_cones {
+    barvinok_options *options;
+    std::deque<cone *> queue;
+    vector<cone *> overflow;
+    size_t bytes;
+
+    pending_cones(barvinok_options *options) : options(options), bytes(0) {}
+    ~pending_cones() {
+	for (int i = 0; i < queue.size(); ++i)
+	    delete queue[i];
+	for (int i = 0; i < overflow.size(); ++i)
+	    delete overflow[i];
+    }
+    bool empty() const {
+	return queue.empty() && overflow.empty();
+    }
+    void push(cone *c);
+    cone *pop();
+};
+
+void pending_cones::push(cone *c)
+{
+    if (options->decompose_memory)
+	c->compact();
+    size_t b = c->bytes();
+    if (options->decompose_memory && bytes + b > options->decompose_memory)
+	overflow.push_back(c);
+    else {
+	queue.push_back(c);
+	if (options->decompose_order == BV_DECOMPOSE_DET)
+	    std::push_heap(queue.begin(), queue.end(), larger_index());
+    }
+    bytes += b;
+
+    long n = queue.size() + overflow.size();
+    if (n > options->stats->decompose_max_cones)
+	options->stats->decompose_max_cones = n;
+    if ((long) bytes > options->stats->decompose_max_bytes)
+	options->stats->decompose_max_bytes = bytes;
+}
+
+cone *pending_cones::pop()
+{
+    cone *c;
+    if (!overflow.empty()) {
+	c = overflow.back();
+	overflow.pop_back();
+    } else if (options->decompose_order == BV_DECOMPOSE_BFS) {
+	c = queue.front();
+	queue.pop_front();
+    } else {
+	if (options->decompose_order == BV_DECOMPOSE_DET)
+	    std::pop_heap(queue.begin(), queue.end(), larger_index());
+	c = queue.back();
+	queue.pop_back();
+    }
+    bytes -= c->bytes();
+    return c;
+}
+
 std::ostream & operator<<(std::ostream & os, const cone& c)
 {
     os << c.rays << endl;
@@ -144,18 +356,96 @@ std::ostream & operator<<(std::ostream & os, const cone& c)
     return os;
 }
 
+/* Pass sc to scc.  If sc is half-open and scc does not handle
+ * half-open cones, then each open ray is first replaced
+ * by its opposite, changing the sign of the cone.
+ */
+void handle_signed_cone(signed_cone_consumer& scc, const signed_cone& sc,
+			barvinok_options *options)
+{
+    if (!sc.closed || scc.handles_open_rays()) {
+	scc.handle(sc, options);
+	return;
+    }
+
+    Polyhedron *C = sc.C;
+    int sgn = sc.sign;
+    mat_ZZ r = sc.rays;
+    for (int j = 0; j < r.NumRows(); ++j) {
+	if (sc.closed[j])
+	    continue;
+	r[j] = -r[j];
+	sgn = -sgn;
+	C = NULL;
+    }
+    scc.handle(signed_cone(C, r, sgn, sc.det), options);
+}
+
+/* Pass the cone with the given rays to scc as a half-open cone.
+ * A point x belongs to the half-open cone if x + epsilon y belongs
+ * to the closed cone for all sufficiently small positive epsilon.
+ * That is, the facet opposite to ray j is closed if the coordinate
+ * of y with respect to ray j is positive.  If this coordinate is zero,
+ * we use a lexicographic perturbation of y, as in is_internal.
+ * Since this perturbation of y is generic, the half-open cones
+ * in a signed decomposition satisfy the same identity as their
+ * closed counterparts, but without any lower-dimensional cones.
+ *
+ * If scc cannot handle half-open cones, then handle_signed_cone
+ * replaces each open ray by its opposite.  The sum of both cones
+ * contains a line and its generating function is therefore zero.
+ */
+static void handle_half_open(Polyhedron *C, const mat_ZZ& rays, int sgn,
+			     unsigned long det, const vec_ZZ& y,
+			     signed_cone_consumer& scc,
+			     barvinok_options *options)
+{
+    int dim = rays.NumRows();
+    vector<int> closed(dim);
+    mat_ZZ A;
+    ZZ d, s;
+
+    inv_fixed(d, A, rays);
+    for (int j = 0; j < dim; ++j) {
+	s = 0;
+	for (int k = 0; k < dim; ++k)
+	    s += y[k] * A[k][j];
+	for (int k = 0; IsZero(s) && k < dim; ++k)
+	    s = A[k][j];
+	closed[j] = sign(s) == sign(d);
+    }
+
+    handle_signed_cone(scc, signed_cone(C, rays, sgn, det, &closed[0]),
+			options);
+}
+
+static void handle_cone(Polyhedron *C, const mat_ZZ& rays, int sgn,
+			unsigned long det, const vec_ZZ *y,
+			signed_cone_consumer& scc, barvinok_options *options)
+{
+    options->stats->base_cones++;
+    if (y)
+	handle_half_open(C, rays, sgn, det, *y, scc, options);
+    else
+	scc.handle(signed_cone(C, rays, sgn, det), options);
+}
+
+/* If y is not NULL, then sc is a half-open cone with respect to y
+ * (see handle_half_open) and so are all the cones in the decomposition.
+ * In this case, there is no need to flip any rays in primal mode.
+ */
 static void decompose(const signed_cone& sc, signed_cone_consumer& scc,
-		      bool primal, barvinok_options *options)
+		      bool primal, barvinok_options *options,
+		      const vec_ZZ *y = NULL)
 {
-    vector<cone *> nonuni;
+    pending_cones nonuni(options);
     cone *c = new cone(sc);
     if (c->needs_split(options)) {
-	nonuni.push_back(c);
+	nonuni.push(c);
     } else {
 	try {
-	    options->stats->base_cones++;
-	    scc.handle(signed_cone(sc.C, sc.rays, sc.sign, to_ulong(c->index)),
-				   options);
+	    handle_cone(sc.C, sc.rays, sc.sign, to_ulong(c->index), y,
+			scc, options);
 	    delete c;
 	} catch (...) {
 	    delete c;
@@ -166,14 +456,13 @@ static void decompose(const signed_cone& sc, signed_cone_consumer& scc,
     vec_ZZ lambda;
     vec_ZZ v;
     while (!nonuni.empty()) {
-	c = nonuni.back();
-	nonuni.pop_back();
+	c = nonuni.pop();
 	c->short_vector(v, lambda, options);
 	for (int i = 0; i < c->rays.NumRows(); ++i) {
 	    if (lambda[i] == 0)
 		continue;
 	    cone *pc = new cone(c->rays, i, v, sign(lambda[i]) * c->sgn);
-	    if (primal) {
+	    if (primal && !y) {
 		for (int j = 0; j <= i; ++j) {
 		    if ((j == i && sign(lambda[i]) < 0) ||
 			(j < i && sign(lambda[i]) == sign(lambda[j]))) {
@@ -184,22 +473,15 @@ static void decompose(const signed_cone& sc, signed_cone_consumer& scc,
 	    }
 	    if (pc->needs_split(options)) {
 		assert(abs(pc->det) < abs(c->det));
-		nonuni.push_back(pc);
+		nonuni.push(pc);
 	    } else {
 		try {
-		    options->stats->base_cones++;
-		    scc.handle(signed_cone(pc->rays, pc->sgn,
-					   to_ulong(pc->index)),
-					   options);
+		    handle_cone(NULL, pc->rays, pc->sgn, to_ulong(pc->index),
+				y, scc, options);
 		    delete pc;
 		} catch (...) {
 		    delete c;
 		    delete pc;
-		    while (!nonuni.empty()) {
-			c = nonuni.back();
-			nonuni.pop_back();
-			delete c;
-		    }
 		    throw;
 		}
 	    }
@@ -290,9 +572,11 @@ static void primal_decompose(Polyhedron *cone, signed_cone_consumer& scc,
 	parts = triangulate_cone_with_options(cone, options);
     Vector *average = NULL;
     Value tmp;
+    vec_ZZ y;
     if (parts != cone) {
 	value_init(tmp);
 	average = inner_point(cone);
+	values2zz(average->p+1, y, cone->Dimension);
     }
     mat_ZZ ray;
     try {
@@ -300,7 +584,7 @@ static void primal_decompose(Polyhedron *cone, signed_cone_consumer& scc,
 	    int sign = 1;
 	    Matrix *Rays = rays2(simple);
 	    for (int i = 0; i < Rays->NbRows; ++i) {
-		if (simple == cone) {
+		if (simple == cone || options->half_open) {
 		    continue;
 		} else {
 		    int f;
@@ -319,7 +603,16 @@ static void primal_decompose(Polyhedron *cone, signed_cone_consumer& scc,
 	    }
 	    matrix2zz(Rays, ray, Rays->NbRows, Rays->NbColumns);
 	    Matrix_Free(Rays);
-	    decompose(signed_cone(simple, ray, sign), scc, true, options);
+	    if (!options->half_open) {
+		decompose(signed_cone(simple, ray, sign), scc, true, options);
+		continue;
+	    }
+	    if (!average) {
+		y.SetLength(ray.NumCols());
+		for (int i = 0; i < ray.NumRows(); ++i)
+		    y += ray[i];
+	    }
+	    decompose(signed_cone(simple, ray, sign), scc, true, options, &y);
 	}
 	Domain_Free(parts);
 	if (parts != cone) {
@@ -338,14 +631,23 @@ static void primal_decompose(Polyhedron *cone, signed_cone_consumer& scc,
     }
 }
 
+void decompose_cone(Polyhedron *C, signed_cone_consumer& scc,
+		    barvinok_options *options)
+{
+    if (options->primal || options->half_open)
+	primal_decompose(C, scc, options);
+    else
+	polar_decompose(C, scc, options);
+}
+
 void barvinok_decompose(Polyhedron *C, signed_cone_consumer& scc,
 			barvinok_options *options)
 {
     POL_ENSURE_VERTICES(C);
-    if (options->primal)
-	primal_decompose(C, scc, options);
+    if (cone_stream_needed(options))
+	stream_decompose(C, scc, options);
     else
-	polar_decompose(C, scc, options);
+	decompose_cone(C, scc, options);
 }
 
 void vertex_decomposer::decompose_at_vertex(Param_Vertices *V, int _i, 
@@ -7,23 +7,35 @@
 
 using namespace NTL;
 
+/* If closed is not NULL, then the cone is half-open and
+ * closed[i] is zero if the facet opposite to ray i is not
+ * included in the cone.
+ */
 struct signed_cone {
-    signed_cone(const mat_ZZ& rays, int sign, unsigned long det) :
-			C(NULL), rays(rays), sign(sign), det(det) {}
+    signed_cone(const mat_ZZ& rays, int sign, unsigned long det,
+		const int *closed = NULL) :
+		C(NULL), rays(rays), sign(sign), det(det), closed(closed) {}
     signed_cone(Polyhedron *C, const mat_ZZ& rays, int sign,
-		unsigned long det = 0) :
-			C(C), rays(rays), sign(sign), det(det) {}
+		unsigned long det = 0, const int *closed = NULL) :
+		C(C), rays(rays), sign(sign), det(det), closed(closed) {}
     Polyhedron *C;
     const mat_ZZ& rays;
     int sign;
     unsigned long det;
+    const int *closed;
 };
 
+/* Consumers that do not handle half-open cones only get closed cones.
+ */
 struct signed_cone_consumer {
     virtual void handle(const signed_cone& sc, barvinok_options *options) = 0;
+    virtual bool handles_open_rays() { return false; }
     virtual ~signed_cone_consumer() {}
 };
 
+void handle_signed_cone(signed_cone_consumer& scc, const signed_cone& sc,
+			barvinok_options *options);
+
 struct vertex_decomposer {
     Param_Polyhedron *PP;
     Param_Vertices *V;	// current vertex
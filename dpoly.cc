@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <NTL/ZZ.h>
@@ -110,40 +111,160 @@ void dpoly::div(const dpoly& d, mpq_t count, int sign)
     Vector_Free(denom);
 }
 
-void dpoly::div(const dpoly& d, mpq_t *count, const mpq_t& factor)
+/* Add the coefficient of the highest power of the quotient
+ * to count, without reducing the fraction.
+ */
+void dpoly::div(const dpoly& d, rational_sum& count, int sign)
 {
     int len = coeff->Size;
     Vector *denom = div(d);
-    mpq_t tmp;
-    mpq_init(tmp);
+    count.add(coeff->p[len-1], denom->p[len-1], sign);
+    Vector_Free(denom);
+}
+
+void dpoly::div(const dpoly& d, rational_sum *count, const mpq_t& factor)
+{
+    int len = coeff->Size;
+    Vector *denom = div(d);
+    Value n, den;
+    value_init(n);
+    value_init(den);
 
     for (int i = 0; i < len; ++i) {
-	value_multiply(mpq_numref(tmp), coeff->p[len-1 - i], mpq_numref(factor));
-	value_multiply(mpq_denref(tmp), denom->p[len-1 - i], mpq_denref(factor));
-	mpq_add(count[i], count[i], tmp);
-	mpq_canonicalize(count[i]);
+	value_multiply(n, coeff->p[len-1 - i], mpq_numref(factor));
+	value_multiply(den, denom->p[len-1 - i], mpq_denref(factor));
+	count[i].add(n, den, 1);
     }
 
-    mpq_clear(tmp);
+    value_clear(n);
+    value_clear(den);
     Vector_Free(denom);
 }
 
-void dpoly_r::add_term(int i, const vector<int>& powers, const ZZ& coeff)
+/* Add sign * n/d to the sum.
+ * If d divides the current denominator, then n is simply scaled up.
+ * Otherwise, the current denominator is multiplied by d.
+ * In the latter case, we reduce the sum when the size of its denominator
+ * exceeds twice the size after the previous reduction (plus some slack
+ * to avoid reducing small fractions all the time),
+ * such that the cost of the reductions is amortized over the additions.
+ */
+void rational_sum::add(const mpz_t n, const mpz_t d, int sign)
+{
+    if (mpz_divisible_p(mpq_denref(q), d)) {
+	mpz_divexact(tmp, mpq_denref(q), d);
+	mpz_mul(tmp, tmp, n);
+    } else {
+	mpz_mul(mpq_numref(q), mpq_numref(q), d);
+	mpz_mul(tmp, mpq_denref(q), n);
+	mpz_mul(mpq_denref(q), mpq_denref(q), d);
+	if (mpz_sgn(d) < 0) {
+	    mpz_neg(mpq_numref(q), mpq_numref(q));
+	    mpz_neg(mpq_denref(q), mpq_denref(q));
+	    mpz_neg(tmp, tmp);
+	}
+    }
+    if (sign == -1)
+	mpz_sub(mpq_numref(q), mpq_numref(q), tmp);
+    else
+	mpz_add(mpq_numref(q), mpq_numref(q), tmp);
+    if (mpz_sizeinbase(mpq_denref(q), 2) > 2 * bits + 64)
+	canonicalize();
+}
+
+void dpoly_r_term_list::push_back(const int *powers, const ZZ& coeff)
+{
+    powers_data.insert(powers_data.end(), powers, powers + dim);
+    coeffs.SetLength(n + 1);
+    coeffs[n] = coeff;
+    ++n;
+}
+
+void dpoly_r_term_list::add(const int *powers, const ZZ& coeff)
 {
     if (coeff == 0)
 	return;
 
-    dpoly_r_term tmp;
-    tmp.powers = powers;
-    dpoly_r_term_list::iterator k = c[i].find(&tmp);
-    if (k != c[i].end()) {
-	(*k)->coeff += coeff;
-	return;
+    int lo = 0, hi = n;
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+	int r = cmp(this->powers(mid), powers, dim);
+	if (r == 0) {
+	    coeffs[mid] += coeff;
+	    return;
+	}
+	if (r < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
     }
-    dpoly_r_term *t = new dpoly_r_term;
-    t->powers = powers;
-    t->coeff = coeff;
-    c[i].insert(t);
+
+    powers_data.insert(powers_data.begin() + lo * dim, powers, powers + dim);
+    coeffs.SetLength(n + 1);
+    for (int j = n; j > lo; --j)
+	NTL::swap(coeffs[j], coeffs[j-1]);
+    coeffs[lo] = coeff;
+    ++n;
+}
+
+/* Add the terms of src, with coefficients multiplied by f and
+ * (if d is not one) divided by d, to this list.
+ * If pos is non-negative, then the power at position pos
+ * of each term in src is increased by one.
+ * Since this increment does not change the relative order
+ * of the terms in src, both lists can be merged in a single pass.
+ * As in add, new terms with a zero coefficient are not added.
+ */
+void dpoly_r_term_list::add(const dpoly_r_term_list& src, int pos,
+			    const ZZ& f, const ZZ& d)
+{
+    dpoly_r_term_list res;
+    vector<int> powers(dim);
+    ZZ coeff;
+    int i = 0, j = 0;
+
+    res.dim = dim;
+    res.powers_data.reserve((n + src.n) * dim);
+    res.coeffs.SetMaxLength(n + src.n);
+    while (i < n || j < src.n) {
+	int r = -1;
+	if (j < src.n) {
+	    std::copy(src.powers(j), src.powers(j) + dim, powers.begin());
+	    if (pos >= 0)
+		powers[pos]++;
+	    r = i < n ? cmp(this->powers(i), &powers[0], dim) : 1;
+	}
+	if (r < 0) {
+	    res.push_back(this->powers(i), ZZ::zero());
+	    NTL::swap(res.coeffs[res.n-1], coeffs[i]);
+	    ++i;
+	    continue;
+	}
+	mul(coeff, src.coeffs[j], f);
+	if (!IsOne(d))
+	    coeff /= d;
+	++j;
+	if (r == 0) {
+	    coeff += coeffs[i];
+	    res.push_back(&powers[0], coeff);
+	    ++i;
+	} else if (coeff != 0)
+	    res.push_back(&powers[0], coeff);
+    }
+    swap(res);
+}
+
+void dpoly_r_term_list::swap(dpoly_r_term_list& other)
+{
+    std::swap(dim, other.dim);
+    std::swap(n, other.n);
+    powers_data.swap(other.powers_data);
+    NTL::swap(coeffs, other.coeffs);
+}
+
+void dpoly_r::add_term(int i, const int *powers, const ZZ& coeff)
+{
+    c[i].add(powers, coeff);
 }
 
 dpoly_r::dpoly_r(int len, int dim)
@@ -152,6 +273,8 @@ dpoly_r::dpoly_r(int len, int dim)
     this->len = len;
     this->dim = dim;
     c = new dpoly_r_term_list[len];
+    for (int i = 0; i < len; ++i)
+	c[i].dim = dim;
 }
 
 dpoly_r::dpoly_r(dpoly& num, int dim)
@@ -164,8 +287,9 @@ dpoly_r::dpoly_r(dpoly& num, int dim)
 
     for (int i = 0; i < len; ++i) {
 	ZZ coeff;
+	c[i].dim = dim;
 	value2zz(num.coeff->p[i], coeff);
-	add_term(i, powers, coeff);
+	add_term(i, &powers[0], coeff);
     }
 }
 
@@ -175,29 +299,23 @@ dpoly_r::dpoly_r(dpoly& num, dpoly& den, int pos, int dim)
     len = num.coeff->Size;
     c = new dpoly_r_term_list[len];
     this->dim = dim;
-    int *powers = new int[dim];
+    vector<int> powers(dim, 0);
+    powers[pos] = 1;
     ZZ coeff;
+    ZZ one;
+    one = 1;
 
     for (int i = 0; i < len; ++i) {
-	vector<int> powers(dim, 0);
-	powers[pos] = 1;
-
+	c[i].dim = dim;
 	value2zz(num.coeff->p[i], coeff);
-	add_term(i, powers, coeff);
+	add_term(i, &powers[0], coeff);
 
 	for (int j = 1; j <= i; ++j) {
-	    dpoly_r_term_list::iterator k;
-	    for (k = c[i-j].begin(); k != c[i-j].end(); ++k) {
-		powers = (*k)->powers;
-		powers[pos]++;
-		value2zz(den.coeff->p[j-1], coeff);
-		negate(coeff, coeff);
-		coeff *= (*k)->coeff;
-		add_term(i, powers, coeff);
-	    }
+	    value2zz(den.coeff->p[j-1], coeff);
+	    negate(coeff, coeff);
+	    c[i].add(c[i-j], pos, coeff, one);
 	}
     }
-    delete [] powers;
     //dump();
 }
 
@@ -208,35 +326,23 @@ dpoly_r::dpoly_r(const dpoly_r* num, dpoly& den, int pos, int dim)
     c = new dpoly_r_term_list[len];
     this->dim = dim;
     ZZ coeff;
+    ZZ one;
+    one = 1;
 
     for (int i = 0 ; i < len; ++i) {
-	dpoly_r_term_list::iterator k;
-	for (k = num->c[i].begin(); k != num->c[i].end(); ++k) {
-	    vector<int> powers = (*k)->powers;
-	    powers[pos]++;
-	    add_term(i, powers, (*k)->coeff);
-	}
+	c[i].dim = dim;
+	c[i].add(num->c[i], pos, one, one);
 
 	for (int j = 1; j <= i; ++j) {
-	    dpoly_r_term_list::iterator k;
-	    for (k = c[i-j].begin(); k != c[i-j].end(); ++k) {
-		vector<int> powers = (*k)->powers;
-		powers[pos]++;
-		value2zz(den.coeff->p[j-1], coeff);
-		negate(coeff, coeff);
-		coeff *= (*k)->coeff;
-		add_term(i, powers, coeff);
-	    }
+	    value2zz(den.coeff->p[j-1], coeff);
+	    negate(coeff, coeff);
+	    c[i].add(c[i-j], pos, coeff, one);
 	}
     }
 }
 
 dpoly_r::~dpoly_r()
 {
-    for (int i = 0 ; i < len; ++i)
-	for (dpoly_r_term_list::iterator k = c[i].begin(); k != c[i].end(); ++k) {
-	    delete (*k);
-	}
     delete [] c;
 }
 
@@ -245,23 +351,19 @@ dpoly_r *dpoly_r::div(const dpoly& d) const
     dpoly_r *rc = new dpoly_r(len, dim);
     ZZ coeff;
     ZZ coeff0;
+    ZZ one;
+    one = 1;
     value2zz(d.coeff->p[0], coeff0);
     rc->denom = power(coeff0, len);
     ZZ inv_d = rc->denom / coeff0;
 
     for (int i = 0; i < len; ++i) {
-	for (dpoly_r_term_list::iterator k = c[i].begin(); k != c[i].end(); ++k) {
-	    coeff = (*k)->coeff * inv_d;
-	    rc->add_term(i, (*k)->powers, coeff);
-	}
+	rc->c[i].add(c[i], -1, inv_d, one);
 
 	for (int j = 1; j <= i; ++j) {
-	    dpoly_r_term_list::iterator k;
-	    for (k = rc->c[i-j].begin(); k != rc->c[i-j].end(); ++k) {
-		value2zz(d.coeff->p[j], coeff);
-		coeff = - coeff * (*k)->coeff / coeff0;
-		rc->add_term(i, (*k)->powers, coeff);
-	    }
+	    value2zz(d.coeff->p[j], coeff);
+	    negate(coeff, coeff);
+	    rc->c[i].add(rc->c[i-j], -1, coeff, coeff0);
 	}
     }
     return rc;
@@ -273,11 +375,11 @@ void dpoly_r::dump(void)
 	cerr << endl;
 	cerr << i << endl;
 	cerr << c[i].size() << endl;
-	for (dpoly_r_term_list::iterator j = c[i].begin(); j != c[i].end(); ++j) {
+	for (int j = 0; j < c[i].size(); ++j) {
 	    for (int k = 0; k < dim; ++k) {
-		cerr << (*j)->powers[k] << " ";
+		cerr << c[i].powers(j)[k] << " ";
 	    }
-	    cerr << ": " << (*j)->coeff << "/" << denom << endl;
+	    cerr << ": " << c[i].coeff(j) << "/" << denom << endl;
 	}
 	cerr << endl;
     }
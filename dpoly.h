@@ -5,11 +5,50 @@
 #include <vector>
 #include <gmp.h>
 #include <NTL/ZZ.h>
+#include <NTL/vec_ZZ.h>
 #include <barvinok/polylib.h>
 #include "conversion.h"
 
 using namespace NTL;
 
+/* A sum of rational numbers that is not kept in canonical form.
+ * As long as the denominator of a term divides the current denominator,
+ * the term is added without any gcd computation.
+ * Otherwise, the denominators are simply multiplied and the
+ * sum is only reduced when its denominator has grown significantly
+ * since the previous reduction.
+ * canonicalize() needs to be called before q is used in
+ * any other GMP operation.
+ */
+struct rational_sum {
+    mpq_t q;
+    mpz_t tmp;
+    /* size of the denominator after the last reduction */
+    size_t bits;
+
+    rational_sum() {
+	mpq_init(q);
+	mpz_init(tmp);
+	bits = 1;
+    }
+    ~rational_sum() {
+	mpq_clear(q);
+	mpz_clear(tmp);
+    }
+    void reset() {
+	mpq_set_si(q, 0, 1);
+	bits = 1;
+    }
+    void add(const mpz_t n, const mpz_t d, int sign);
+    void add(const mpq_t v, int sign) {
+	add(mpq_numref(v), mpq_denref(v), sign);
+    }
+    void canonicalize() {
+	mpq_canonicalize(q);
+	bits = mpz_sizeinbase(mpq_denref(q), 2);
+    }
+};
+
 class dpoly {
 public:
     Vector *coeff;
@@ -28,26 +67,47 @@ public:
     void operator *= (const Value f);
     void operator *= (const dpoly& f);
     void div(const dpoly& d, mpq_t count, int sign);
-    void div(const dpoly& d, mpq_t *count, const mpq_t& factor);
+    void div(const dpoly& d, rational_sum& count, int sign);
+    void div(const dpoly& d, rational_sum *count, const mpq_t& factor);
     Vector *div(const dpoly &d);
 };
 
-/* Each element in powers corresponds to a factor of the form (1 - z^b)
+/* The terms of a single coefficient of a dpoly_r.
+ * Each term has a vector of dim powers and a coefficient.
+ * Each element in powers corresponds to a factor of the form (1 - z^b)
  * and indicates the exponent of this factor in the denominator.
  * The constants b are stored elsewhere (den_r in reducer::reducer).
+ *
+ * The terms are kept sorted lexicographically on their powers.
+ * The powers of term i are stored at position i * dim of powers_data
+ * and its coefficient in element i of coeffs, such that
+ * terms can be merged in a single pass over both arrays.
  */
-struct dpoly_r_term {
-    std::vector<int>    powers;
-    ZZ	    	    	coeff;
-};
+struct dpoly_r_term_list {
+    int			dim;
+    int			n;
+    std::vector<int>	powers_data;
+    vec_ZZ		coeffs;
+
+    dpoly_r_term_list() : dim(0), n(0) {}
 
-struct dpoly_r_term_lex_smaller {
-    bool operator()(const dpoly_r_term* t1, const dpoly_r_term* t2) const {
-	return t1->powers < t2->powers;
+    int size() const { return n; }
+    const int *powers(int i) const { return &powers_data[i * dim]; }
+    ZZ& coeff(int i) { return coeffs[i]; }
+    const ZZ& coeff(int i) const { return coeffs[i]; }
+
+    static int cmp(const int *p1, const int *p2, int dim) {
+	for (int k = 0; k < dim; ++k)
+	    if (p1[k] != p2[k])
+		return p1[k] < p2[k] ? -1 : 1;
+	return 0;
     }
-};
 
-typedef std::set<dpoly_r_term*, dpoly_r_term_lex_smaller> dpoly_r_term_list;
+    void push_back(const int *powers, const ZZ& coeff);
+    void add(const int *powers, const ZZ& coeff);
+    void add(const dpoly_r_term_list& src, int pos, const ZZ& f, const ZZ& d);
+    void swap(dpoly_r_term_list& other);
+};
 
 /* len: number of elements in c
  * each element in c is the coefficient of a power of t
@@ -59,7 +119,7 @@ struct dpoly_r {
     int dim;
     ZZ denom;
 
-    void add_term(int i, const std::vector<int>& powers, const ZZ& coeff);
+    void add_term(int i, const int *powers, const ZZ& coeff);
     dpoly_r(int len, int dim);
     dpoly_r(dpoly& num, int dim);
     dpoly_r(dpoly& num, dpoly& den, int pos, int dim);
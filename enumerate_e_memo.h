@@ -0,0 +1,25 @@
+#ifndef ENUMERATE_E_MEMO_H
+#define ENUMERATE_E_MEMO_H
+
+#include <barvinok/options.h>
+
+struct enumerate_e_memo;
+
+/* While an enumerate_e_memo_scope is alive, all calls to
+ * barvinok_enumerate_e_with_options with the given options
+ * (or copies made by parallel_for) share a single table of
+ * memoized subproblems.  The table is freed when the scope ends.
+ * A scope is created for each outermost call, so it only needs
+ * to be created explicitly to share the table across several calls.
+ * If memoization is disabled or a table is already attached
+ * to options, then the scope has no effect.
+ */
+struct enumerate_e_memo_scope {
+    barvinok_options *options;
+    enumerate_e_memo *memo;
+
+    enumerate_e_memo_scope(barvinok_options *options);
+    ~enumerate_e_memo_scope();
+};
+
+#endif
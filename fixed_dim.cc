@@ -0,0 +1,178 @@
+#include <math.h>
+#include <NTL/mat_ZZ.h>
+#include "fixed_dim.h"
+
+/* Determinants and adjugates of small square matrices.
+ *
+ * For each dimension 1 up to FIXED_DIM_MAX, a kernel operating
+ * on a stack allocated array of machine integers is instantiated.
+ * Since the dimension is a compile time constant, the loops
+ * can be fully unrolled by the compiler.
+ * The kernel is only used if all minors of the matrix are known
+ * to fit in 62 bits, based on the Hadamard bound.
+ * In all other cases, we fall back to the NTL routines.
+ */
+
+#ifdef __SIZEOF_INT128__
+
+/* Compute the determinant of the N x N matrix a using fraction-free
+ * Gaussian elimination (Bareiss).  The matrix a is destroyed.
+ * All intermediate values are minors of the original matrix,
+ * only the products are computed in 128 bits.
+ */
+template <int N>
+static long det_fixed(long a[N][N])
+{
+    long prev = 1;
+    int s = 1;
+
+    for (int k = 0; k < N-1; ++k) {
+	if (a[k][k] == 0) {
+	    int i;
+	    for (i = k+1; i < N; ++i)
+		if (a[i][k] != 0)
+		    break;
+	    if (i == N)
+		return 0;
+	    for (int j = k; j < N; ++j) {
+		long t = a[k][j];
+		a[k][j] = a[i][j];
+		a[i][j] = t;
+	    }
+	    s = -s;
+	}
+	for (int i = k+1; i < N; ++i)
+	    for (int j = k+1; j < N; ++j)
+		a[i][j] = (long) (((__int128) a[i][j] * a[k][k] -
+				   (__int128) a[i][k] * a[k][j]) / prev);
+	prev = a[k][k];
+    }
+    return s * a[N-1][N-1];
+}
+
+/* Compute the adjugate of the N x N matrix a as the transpose
+ * of its matrix of cofactors.
+ */
+template <int N>
+static void adj_fixed(long a[N][N], long adj[N][N])
+{
+    long m[N-1][N-1];
+
+    for (int r = 0; r < N; ++r)
+	for (int c = 0; c < N; ++c) {
+	    for (int i = 0, k = 0; i < N; ++i) {
+		if (i == r)
+		    continue;
+		for (int j = 0, l = 0; j < N; ++j) {
+		    if (j == c)
+			continue;
+		    m[k][l++] = a[i][j];
+		}
+		++k;
+	    }
+	    long d = det_fixed<N-1>(m);
+	    adj[c][r] = (r + c) % 2 ? -d : d;
+	}
+}
+
+template <>
+void adj_fixed<1>(long a[1][1], long adj[1][1])
+{
+    adj[0][0] = 1;
+}
+
+template <int N>
+static void kernel_fixed(ZZ& d, mat_ZZ *X, const mat_ZZ& A)
+{
+    long a[N][N];
+    long b[N][N];
+
+    for (int i = 0; i < N; ++i)
+	for (int j = 0; j < N; ++j)
+	    a[i][j] = to_long(A[i][j]);
+
+    if (X) {
+	adj_fixed<N>(a, b);
+	X->SetDims(N, N);
+	for (int i = 0; i < N; ++i)
+	    for (int j = 0; j < N; ++j)
+		conv((*X)[i][j], b[i][j]);
+    }
+
+    d = det_fixed<N>(a);
+}
+
+/* Check that the Hadamard bound on the minors of A is smaller than 2^60,
+ * leaving some room for rounding errors in the computation of the bound.
+ * Rows are taken to have norm at least one so that the bound also
+ * applies to the minors that do not involve a zero row.
+ */
+static bool fits_fixed(const mat_ZZ& A)
+{
+    int n = A.NumRows();
+    double log_bound = 0;
+
+    if (n < 1 || n > FIXED_DIM_MAX || A.NumCols() != n)
+	return false;
+
+    for (int i = 0; i < n; ++i) {
+	double norm2 = 0;
+	for (int j = 0; j < n; ++j) {
+	    if (NumBits(A[i][j]) > 60)
+		return false;
+	    double a = to_double(A[i][j]);
+	    norm2 += a * a;
+	}
+	if (norm2 > 1)
+	    log_bound += log2(norm2) / 2;
+    }
+    return log_bound < 60;
+}
+
+static bool dispatch_fixed(ZZ& d, mat_ZZ *X, const mat_ZZ& A)
+{
+    if (!fits_fixed(A))
+	return false;
+
+    switch (A.NumRows()) {
+    case 1:	kernel_fixed<1>(d, X, A); break;
+    case 2:	kernel_fixed<2>(d, X, A); break;
+    case 3:	kernel_fixed<3>(d, X, A); break;
+    case 4:	kernel_fixed<4>(d, X, A); break;
+    case 5:	kernel_fixed<5>(d, X, A); break;
+    case 6:	kernel_fixed<6>(d, X, A); break;
+    case 7:	kernel_fixed<7>(d, X, A); break;
+    case 8:	kernel_fixed<8>(d, X, A); break;
+    default:
+	return false;
+    }
+    return true;
+}
+
+#else
+
+static bool dispatch_fixed(ZZ& d, mat_ZZ *X, const mat_ZZ& A)
+{
+    return false;
+}
+
+#endif
+
+/* Compute the determinant d of A, using a kernel specialized
+ * to the dimension of A when possible.
+ */
+void determinant_fixed(ZZ& d, const mat_ZZ& A)
+{
+    if (!dispatch_fixed(d, NULL, A))
+	determinant(d, A);
+}
+
+/* Compute the determinant d of A and X = d A^{-1}, i.e., the adjugate
+ * of A, as in NTL's inv, using a kernel specialized to the dimension
+ * of A when possible.
+ */
+void inv_fixed(ZZ& d, mat_ZZ& X, const mat_ZZ& A)
+{
+    if (!dispatch_fixed(d, &X, A))
+	inv(d, X, A);
+}
@@ -0,0 +1,14 @@
+#ifndef FIXED_DIM_H
+#define FIXED_DIM_H
+
+#include <NTL/mat_ZZ.h>
+
+using namespace NTL;
+
+/* Largest dimension for which a specialized kernel is instantiated */
+#define FIXED_DIM_MAX	8
+
+void determinant_fixed(ZZ& d, const mat_ZZ& A);
+void inv_fixed(ZZ& d, mat_ZZ& X, const mat_ZZ& A);
+
+#endif
@@ -13,6 +13,7 @@
 #include "genfun_constructor.h"
 #include "mat_util.h"
 #include "matrix_read.h"
+#include "parallel.h"
 #include "remove_equalities.h"
 
 using std::cout;
@@ -176,6 +177,92 @@ QQ short_rat::coefficient(Value* params, barvinok_options *options) const
     return c;
 }
 
+/* Is the set { x >= 0 : x d = 0 } equal to { 0 }?
+ * If so, then the polytopes that are counted in coefficient
+ * are bounded for any value of the parameters.
+ */
+static bool bounded_terms(const mat_ZZ& d, barvinok_options *options)
+{
+    unsigned nvar = d.NumRows();
+    unsigned nparam = d.NumCols();
+    Matrix *C = Matrix_Alloc(nparam + nvar, 1 + nvar + 1);
+    for (int r = 0; r < nparam; ++r)
+	for (int c = 0; c < nvar; ++c)
+	    zz2value(d[c][r], C->p[r][1+c]);
+    for (int r = 0; r < nvar; ++r) {
+	value_set_si(C->p[nparam+r][0], 1);
+	value_set_si(C->p[nparam+r][1+r], 1);
+    }
+    Polyhedron *P = Constraints2Polyhedron(C, options->MaxRays);
+    Matrix_Free(C);
+    bool bounded = true;
+    for (int i = 0; i < P->NbRays; ++i)
+	if (value_zero_p(P->Ray[i][1+nvar]))
+	    bounded = false;
+    Polyhedron_Free(P);
+    return bounded;
+}
+
+/* Add the coefficients of this term of the monomials with exponents
+ * given by the rows of points to c.
+ * For each numerator, the number of points in the polytope
+ * of coefficient is computed parametrically, once,
+ * and then evaluated at each of the points.
+ * If the polytopes may be unbounded, we fall back to coefficient.
+ */
+void short_rat::coefficients(Matrix *points, vec_QQ& c,
+			     barvinok_options *options) const
+{
+    unsigned nvar = d.power.NumRows();
+    unsigned nparam = d.power.NumCols();
+
+    if (nvar == 0 || !bounded_terms(d.power, options)) {
+	for (int p = 0; p < points->NbRows; ++p)
+	    c[p] += coefficient(points->p[p], options);
+	return;
+    }
+
+    Matrix *C = Matrix_Alloc(nparam + nvar, 1 + nvar + nparam + 1);
+    for (int r = 0; r < nparam; ++r) {
+	for (int c = 0; c < nvar; ++c)
+	    zz2value(d.power[c][r], C->p[r][1+c]);
+	value_set_si(C->p[r][1+nvar+r], -1);
+    }
+    for (int r = 0; r < nvar; ++r) {
+	value_set_si(C->p[nparam+r][0], 1);
+	value_set_si(C->p[nparam+r][1+r], 1);
+    }
+    Polyhedron *U = Universe_Polyhedron(nparam);
+
+    for (int j = 0; j < n.coeff.length(); ++j) {
+	for (int r = 0; r < nparam; ++r)
+	    zz2value(n.power[j][r], C->p[r][1+nvar+nparam]);
+	Polyhedron *P = Constraints2Polyhedron(C, options->MaxRays);
+	if (emptyQ2(P)) {
+	    Polyhedron_Free(P);
+	    continue;
+	}
+	evalue *EP = barvinok_enumerate_with_options(P, U, options);
+	Polyhedron_Free(P);
+	for (int p = 0; p < points->NbRows; ++p) {
+	    evalue *v = evalue_eval(EP, points->p[p]);
+	    assert(value_notzero_p(v->d));
+	    if (value_notzero_p(v->x.n)) {
+		QQ c2;
+		value2zz(v->x.n, c2.n);
+		value2zz(v->d, c2.d);
+		c2 *= n.coeff[j];
+		c[p] += c2;
+	    }
+	    evalue_free(v);
+	}
+	evalue_free(EP);
+    }
+
+    Polyhedron_Free(U);
+    Matrix_Free(C);
+}
+
 bool short_rat::reduced()
 {
     int dim = n.power.NumCols();
@@ -616,74 +703,118 @@ struct parallel_polytopes {
     }
 };
 
-gen_fun *gen_fun::Hadamard_product(const gen_fun *gf, barvinok_options *options)
+/* Compute the contribution of the pair of terms i and i2
+ * to the Hadamard product with context C.
+ * The polytopes of the pair that are parallel to each other
+ * are handled together by parallel_polytopes.
+ */
+gen_fun *gen_fun::Hadamard_product(const short_rat *i, const short_rat *i2,
+				   Polyhedron *C, barvinok_options *options)
 {
     QQ one(1, 1);
-    Polyhedron *C = DomainIntersection(context, gf->context, options->MaxRays);
-    gen_fun *sum = new gen_fun(C);
-
-    int j = 0;
-    for (short_rat_list::iterator i = term.begin(); i != term.end(); ++i, j++) {
-	int k = 0;
-	for (short_rat_list::iterator i2 = gf->term.begin();
-		i2 != gf->term.end();
-		++i2, k++) {
-	    int d = (*i)->d.power.NumCols();
-	    int k1 = (*i)->d.power.NumRows();
-	    int k2 = (*i2)->d.power.NumRows();
-	    assert((*i)->d.power.NumCols() == (*i2)->d.power.NumCols());
-
-	    if (options->verbose)
-		fprintf(stderr, "HP: %d/%zd %d/%zd \r",
-				    j, term.size(), k, gf->term.size());
-
-	    parallel_polytopes pp((*i)->n.power.NumRows() *
-				  (*i2)->n.power.NumRows(),
-				  sum->context, d, options);
-
-	    for (int j = 0; j < (*i)->n.power.NumRows(); ++j) {
-		for (int j2 = 0; j2 < (*i2)->n.power.NumRows(); ++j2) {
-		    Matrix *M = Matrix_Alloc(k1+k2+d+d, 1+k1+k2+d+1);
-		    for (int k = 0; k < k1+k2; ++k) {
-			value_set_si(M->p[k][0], 1);
-			value_set_si(M->p[k][1+k], 1);
-		    }
-		    for (int k = 0; k < d; ++k) {
-			value_set_si(M->p[k1+k2+k][1+k1+k2+k], -1);
-			zz2value((*i)->n.power[j][k], M->p[k1+k2+k][1+k1+k2+d]);
-			for (int l = 0; l < k1; ++l)
-			    zz2value((*i)->d.power[l][k], M->p[k1+k2+k][1+l]);
-		    }
-		    for (int k = 0; k < d; ++k) {
-			value_set_si(M->p[k1+k2+d+k][1+k1+k2+k], -1);
-			zz2value((*i2)->n.power[j2][k], 
-				 M->p[k1+k2+d+k][1+k1+k2+d]);
-			for (int l = 0; l < k2; ++l)
-			    zz2value((*i2)->d.power[l][k], 
-				     M->p[k1+k2+d+k][1+k1+l]);
-		    }
-		    Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
-		    Matrix_Free(M);
-
-		    QQ c = (*i)->n.coeff[j];
-		    c *= (*i2)->n.coeff[j2];
-		    if (!pp.add(c, P)) {
-			gen_fun *t = barvinok_enumerate_series(P, C->Dimension, options);
-			sum->add(c, t);
-			delete t;
-		    }
-
-		    Polyhedron_Free(P);
-		}
+    gen_fun *sum = new gen_fun(Polyhedron_Copy(C));
+    int d = i->d.power.NumCols();
+    int k1 = i->d.power.NumRows();
+    int k2 = i2->d.power.NumRows();
+    assert(i->d.power.NumCols() == i2->d.power.NumCols());
+
+    parallel_polytopes pp(i->n.power.NumRows() * i2->n.power.NumRows(),
+			  sum->context, d, options);
+
+    for (int j = 0; j < i->n.power.NumRows(); ++j) {
+	for (int j2 = 0; j2 < i2->n.power.NumRows(); ++j2) {
+	    Matrix *M = Matrix_Alloc(k1+k2+d+d, 1+k1+k2+d+1);
+	    for (int k = 0; k < k1+k2; ++k) {
+		value_set_si(M->p[k][0], 1);
+		value_set_si(M->p[k][1+k], 1);
 	    }
+	    for (int k = 0; k < d; ++k) {
+		value_set_si(M->p[k1+k2+k][1+k1+k2+k], -1);
+		zz2value(i->n.power[j][k], M->p[k1+k2+k][1+k1+k2+d]);
+		for (int l = 0; l < k1; ++l)
+		    zz2value(i->d.power[l][k], M->p[k1+k2+k][1+l]);
+	    }
+	    for (int k = 0; k < d; ++k) {
+		value_set_si(M->p[k1+k2+d+k][1+k1+k2+k], -1);
+		zz2value(i2->n.power[j2][k], 
+			 M->p[k1+k2+d+k][1+k1+k2+d]);
+		for (int l = 0; l < k2; ++l)
+		    zz2value(i2->d.power[l][k], 
+			     M->p[k1+k2+d+k][1+k1+l]);
+	    }
+	    Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
+	    Matrix_Free(M);
 
-	    gen_fun *t = pp.compute();
-	    if (t) {
-		sum->add(one, t);
+	    QQ c = i->n.coeff[j];
+	    c *= i2->n.coeff[j2];
+	    if (!pp.add(c, P)) {
+		gen_fun *t = barvinok_enumerate_series(P, C->Dimension, options);
+		sum->add(c, t);
 		delete t;
 	    }
+
+	    Polyhedron_Free(P);
 	}
     }
+
+    gen_fun *t = pp.compute();
+    if (t) {
+	sum->add(one, t);
+	delete t;
+    }
+
+    return sum;
+}
+
+/* The pairs of terms of the Hadamard product, to be handled
+ * by parallel_for.  The result of pair k is stored in part[k].
+ */
+struct Hadamard_pairs : public parallel_body {
+    vector<const short_rat *> t1;
+    vector<const short_rat *> t2;
+    Polyhedron *C;
+    vector<gen_fun *> part;
+
+    Hadamard_pairs(Polyhedron *C) : C(C) {}
+    ~Hadamard_pairs() {
+	for (int k = 0; k < part.size(); ++k)
+	    delete part[k];
+    }
+    virtual void run(int k, barvinok_options *options) {
+	int n2 = t2.size();
+
+	if (options->verbose)
+	    fprintf(stderr, "HP: %d/%zd %d/%zd \r",
+			    k / n2, t1.size(), k % n2, t2.size());
+	part[k] = gen_fun::Hadamard_product(t1[k / n2], t2[k % n2],
+					    C, options);
+    }
+};
+
+/* Compute the Hadamard product of "this" and "gf".
+ * The pairs of terms are handled independently (possibly in parallel)
+ * and their contributions are then added to the result in the order
+ * of the pairs, such that the result does not depend on the number
+ * of threads.
+ */
+gen_fun *gen_fun::Hadamard_product(const gen_fun *gf, barvinok_options *options)
+{
+    QQ one(1, 1);
+    Polyhedron *C = DomainIntersection(context, gf->context, options->MaxRays);
+    gen_fun *sum = new gen_fun(C);
+    Hadamard_pairs pairs(C);
+
+    for (short_rat_list::iterator i = term.begin(); i != term.end(); ++i)
+	pairs.t1.push_back(*i);
+    for (short_rat_list::iterator i2 = gf->term.begin();
+	    i2 != gf->term.end(); ++i2)
+	pairs.t2.push_back(*i2);
+    pairs.part.resize(pairs.t1.size() * pairs.t2.size(), NULL);
+
+    parallel_for(pairs.part.size(), pairs, options);
+
+    for (int k = 0; k < pairs.part.size(); ++k)
+	sum->add(one, pairs.part[k]);
     return sum;
 }
 
@@ -956,6 +1087,50 @@ ZZ gen_fun::coefficient(Value* params, barvinok_options *options) const
     return sum.n;
 }
 
+/* Compute the coefficients of the monomials with exponents given
+ * by the rows of points and store them in c, which is assumed
+ * to have been initialized.
+ * This is equivalent to calling coefficient on each of the rows,
+ * but the parametric polytopes of the terms are only constructed
+ * and counted once.
+ */
+void gen_fun::coefficients(Matrix *points, Value *c,
+			   barvinok_options *options) const
+{
+    if (points->NbRows == 0)
+	return;
+
+    Matrix *in = Matrix_Alloc(points->NbRows, points->NbColumns);
+    vector<int> pos(points->NbRows, -1);
+
+    in->NbRows = 0;
+    for (int p = 0; p < points->NbRows; ++p) {
+	if (!in_domain(context, points->p[p]))
+	    continue;
+	pos[p] = in->NbRows;
+	Vector_Copy(points->p[p], in->p[in->NbRows++], points->NbColumns);
+    }
+
+    vec_QQ sum;
+    sum.SetLength(in->NbRows);
+    for (int p = 0; p < in->NbRows; ++p)
+	sum[p] = QQ(0, 1);
+    for (short_rat_list::iterator i = term.begin(); i != term.end(); ++i)
+	(*i)->coefficients(in, sum, options);
+
+    for (int p = 0; p < points->NbRows; ++p) {
+	if (pos[p] < 0) {
+	    value_set_si(c[p], 0);
+	    continue;
+	}
+	assert(sum[pos[p]].d == 1);
+	zz2value(sum[pos[p]].n, c[p]);
+    }
+
+    in->NbRows = points->NbRows;
+    Matrix_Free(in);
+}
+
 void gen_fun::coefficient(Value* params, Value* c) const
 {
     barvinok_options *options = barvinok_options_new_with_defaults();
@@ -1025,14 +1200,15 @@ bool gen_fun::summate(Value *sum) const
     for (short_rat_list::iterator i = term.begin(); i != term.end(); ++i)
 	cnt.reduce((*i)->n.coeff, (*i)->n.power, (*i)->d.power);
 
+    cnt.canonicalize();
     for (int i = 1; i <= maxlen; ++i)
-	if (value_notzero_p(mpq_numref(cnt.count[i]))) {
+	if (value_notzero_p(mpq_numref(cnt.count[i].q))) {
 	    value_set_si(*sum, -1);
 	    return false;
 	}
 
-    assert(value_one_p(mpq_denref(cnt.count[0])));
-    value_assign(*sum, mpq_numref(cnt.count[0]));
+    assert(value_one_p(mpq_denref(cnt.count[0].q)));
+    value_assign(*sum, mpq_numref(cnt.count[0].q));
     return true;
 }
 
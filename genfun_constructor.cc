@@ -74,6 +74,8 @@ void partial_bfcounter::base(mat_ZZ& factors, bfc_vec& v)
     mat_ZZ den;
     unsigned nf = factors.NumRows();
 
+    vec_ZZ num;
+
     for (int i = 0; i < v.size(); ++i) {
 	bfc_term* bfct = static_cast<bfc_term *>(v[i]);
 	den.SetDims(0, lower);
@@ -85,8 +87,10 @@ void partial_bfcounter::base(mat_ZZ& factors, bfc_vec& v)
 	    for (int k = 0; k < v[i]->powers[j]; ++k)
 		den[p++] = factors[j];
 	}
-	for (int j = 0; j < v[i]->terms.NumRows(); ++j)
-	    gf->add(bfct->c[j], v[i]->terms[j], den);
+	for (int j = 0; j < v[i]->terms.NumRows(); ++j) {
+	    v[i]->terms.get(j, num);
+	    gf->add(bfct->c[j], num, den);
+	}
 	delete v[i];
     }
 }
@@ -1,46 +1,13 @@
 #include <assert.h>
 #include <stdlib.h>
-#define Vector ZSolveVector
-#define Matrix ZSolveMatrix
-#include "zsolve/libzsolve.h"
-#undef Vector
-#undef Matrix
 #include <barvinok/options.h>
 #include <barvinok/util.h>
 #include "hilbert.h"
+#include "hilbert_zsolve.h"
 #include "normalization.h"
 #include "polysign.h"
 #include "remove_equalities.h"
 
-static ZSolveMatrix Matrix2zsolve(Matrix *M)
-{
-    int i, j;
-    ZSolveMatrix zmatrix;
-
-    zmatrix = createMatrix(M->NbColumns-2, M->NbRows);
-    for (i = 0; i < M->NbRows; ++i)
-	for (j = 0; j < M->NbColumns-2; ++j) {
-	    assert(mpz_cmp_si(M->p[i][1+j], -MAXINT) > 0);
-	    assert(mpz_cmp_si(M->p[i][1+j], MAXINT) < 0);
-	    zmatrix->Data[i*zmatrix->Width+j] = mpz_get_si(M->p[i][1+j]);
-	}
-
-    return zmatrix;
-}
-
-static Matrix *VectorArray2Matrix(VectorArray array, unsigned cols)
-{
-    int i, j;
-    Matrix *M = Matrix_Alloc(array->Size, cols+1);
-
-    for (i = 0; i < array->Size; ++i) {
-	for (j = 0; j < cols; ++j)
-	    value_set_si(M->p[i][j], array->Data[i][j]);
-	value_set_si(M->p[i][cols], 1);
-    }
-    return M;
-}
-
 static void Polyhedron_Remove_Positivity_Constraint(Polyhedron *P)
 {
     int i;
@@ -111,17 +78,18 @@ static Matrix *Polyhedron2standard_form(Polyhedron *P, Matrix **T)
 /* Assumes C is a linear cone (i.e. with apex zero).
  * All equalities are removed first to speed up the computation
  * in zsolve.
+ * The computation is first performed on 32-bit integers and
+ * is repeated on 64-bit integers if any of the (intermediate)
+ * coefficients does not fit.
+ * Return NULL if the coefficients do not fit in 64-bit integers either.
  */
-Matrix *Cone_Hilbert_Basis(Polyhedron *C, unsigned MaxRays)
+Matrix *Cone_Hilbert_Basis(Polyhedron *C, struct barvinok_options *options)
 {
+    unsigned MaxRays = options->MaxRays;
     unsigned dim;
     int i;
-    Matrix *M2, *M3, *T;
+    Matrix *M, *M2, *M3, *T;
     Matrix *CV = NULL;
-    LinearSystem initialsystem;
-    ZSolveMatrix matrix;
-    ZSolveVector rhs;
-    ZSolveContext ctx;
 
     remove_all_equalities(&C, NULL, NULL, &CV, 0, MaxRays);
     dim = C->Dimension;
@@ -130,29 +98,22 @@ Matrix *Cone_Hilbert_Basis(Polyhedron *C, unsigned MaxRays)
 	assert(value_zero_p(C->Constraint[i][1+dim]) ||
 	       First_Non_Zero(C->Constraint[i]+1, dim) == -1);
 
-    M2 = Polyhedron2standard_form(C, &T);
-    matrix = Matrix2zsolve(M2);
-    Matrix_Free(M2);
-
-    rhs = createVector(matrix->Height);
-    for (i = 0; i < matrix->Height; i++)
-	rhs[i] = 0;
-
-    initialsystem = createLinearSystem();
-    setLinearSystemMatrix(initialsystem, matrix);
-    deleteMatrix(matrix);
-
-    setLinearSystemRHS(initialsystem, rhs);
-    deleteVector(rhs);
-
-    setLinearSystemLimit(initialsystem, -1, 0, MAXINT, 0);
-    setLinearSystemEquationType(initialsystem, -1, EQUATION_EQUAL, 0);
-
-    ctx = createZSolveContextFromSystem(initialsystem, NULL, 0, 0, NULL, NULL);
-    zsolveSystem(ctx, 0);
+    M = Polyhedron2standard_form(C, &T);
+    M2 = zsolve_hilbert_basis32(M, dim, options);
+    if (!M2) {
+	options->stats->hilbert_int64++;
+	M2 = zsolve_hilbert_basis64(M, dim, options);
+    }
+    Matrix_Free(M);
+    if (!M2) {
+	Matrix_Free(T);
+	if (CV) {
+	    Matrix_Free(CV);
+	    Polyhedron_Free(C);
+	}
+	return NULL;
+    }
 
-    M2 = VectorArray2Matrix(ctx->Homs, C->Dimension);
-    deleteZSolveContext(ctx, 1);
     Matrix_Transposition(T);
     M3 = Matrix_Alloc(M2->NbRows, M2->NbColumns);
     Matrix_Product(M2, T, M3);
@@ -196,17 +157,21 @@ static int lex_cmp(const void *va, const void *vb)
  * Here, we do this by first computing the Hilbert basis of C
  * and then discarding elements from this basis that are rational
  * overconvex combinations of other elements in the basis.
+ * Return NULL if the Hilbert basis could not be computed.
  */
 Matrix *Cone_Hilbert_Integer_Hull(Polyhedron *C,
 				  struct barvinok_options *options)
 {
     int i, j, k;
-    Matrix *hilbert = Cone_Hilbert_Basis(C, options->MaxRays);
+    Matrix *hilbert = Cone_Hilbert_Basis(C, options);
     Matrix *rays, *hull;
     unsigned dim = C->Dimension;
     Value tmp;
     unsigned MaxRays = options->MaxRays;
 
+    if (!hilbert)
+	return NULL;
+
     /* When checking for redundant points below, we want to
      * check if there are any _rational_ solutions.
      */
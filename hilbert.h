@@ -6,7 +6,7 @@ extern "C" {
 
 struct barvinok_options;
 
-Matrix *Cone_Hilbert_Basis(Polyhedron *C, unsigned MaxRays);
+Matrix *Cone_Hilbert_Basis(Polyhedron *C, struct barvinok_options *options);
 Matrix *Cone_Hilbert_Integer_Hull(Polyhedron *C,
 				  struct barvinok_options *options);
 
@@ -0,0 +1,21 @@
+#ifndef HILBERT_ZSOLVE_H
+#define HILBERT_ZSOLVE_H
+
+#include <barvinok/polylib.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+struct barvinok_options;
+
+Matrix *zsolve_hilbert_basis32(Matrix *M, unsigned dim,
+			       struct barvinok_options *options);
+Matrix *zsolve_hilbert_basis64(Matrix *M, unsigned dim,
+			       struct barvinok_options *options);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
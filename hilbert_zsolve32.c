@@ -0,0 +1,2 @@
+#define ZSOLVE_HILBERT_BASIS zsolve_hilbert_basis32
+#include "hilbert_zsolve_templ.c"
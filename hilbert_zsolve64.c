@@ -0,0 +1,3 @@
+#define ZSOLVE_INT64
+#define ZSOLVE_HILBERT_BASIS zsolve_hilbert_basis64
+#include "hilbert_zsolve_templ.c"
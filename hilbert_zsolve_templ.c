@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#define Vector ZSolveVector
+#define Matrix ZSolveMatrix
+#include "zsolve/libzsolve.h"
+#undef Vector
+#undef Matrix
+#include <barvinok/options.h>
+#include <barvinok/util.h>
+#include "hilbert_zsolve.h"
+#include "parallel.h"
+
+/* The computation of a Hilbert basis by an instance of zsolve
+ * with entries of type vector_t.
+ * This file is included from hilbert_zsolve32.c and hilbert_zsolve64.c,
+ * which define ZSOLVE_HILBERT_BASIS to the name of the instance
+ * and, for the 64-bit instance, ZSOLVE_INT64.
+ */
+
+/* Does v fit in a vector_t and its opposite as well?
+ */
+static int value_fits(Value v)
+{
+    return mpz_fits_slong_p(v) && mpz_sizeinbase(v, 2) < 8 * sizeof(vector_t);
+}
+
+static void value_set_vector_t(Value v, vector_t x)
+{
+    unsigned long long u;
+
+    if (x >= LONG_MIN && x <= LONG_MAX) {
+	value_set_si(v, x);
+	return;
+    }
+    u = x < 0 ? -(unsigned long long) x : x;
+    mpz_import(v, 1, 1, sizeof(u), 0, 0, &u);
+    if (x < 0)
+	value_oppose(v, v);
+}
+
+/* Return NULL if any of the coefficients does not fit in a vector_t.
+ */
+static ZSolveMatrix Matrix2zsolve(Matrix *M)
+{
+    int i, j;
+    ZSolveMatrix zmatrix;
+
+    zmatrix = createMatrix(M->NbColumns-2, M->NbRows);
+    for (i = 0; i < M->NbRows; ++i)
+	for (j = 0; j < M->NbColumns-2; ++j) {
+	    if (!value_fits(M->p[i][1+j])) {
+		deleteMatrix(zmatrix);
+		return NULL;
+	    }
+	    zmatrix->Data[i*zmatrix->Width+j] = mpz_get_si(M->p[i][1+j]);
+	}
+
+    return zmatrix;
+}
+
+static Matrix *VectorArray2Matrix(VectorArray array, unsigned cols)
+{
+    int i, j;
+    Matrix *M = Matrix_Alloc(array->Size, cols+1);
+
+    for (i = 0; i < array->Size; ++i) {
+	for (j = 0; j < cols; ++j)
+	    value_set_vector_t(M->p[i][j], array->Data[i][j]);
+	value_set_si(M->p[i][cols], 1);
+    }
+    return M;
+}
+
+struct zsolve_tasks {
+    void (*task)(int i, void *user);
+    void *user;
+};
+
+static void zsolve_task(int i, struct barvinok_options *options, void *user)
+{
+    struct zsolve_tasks *tasks = (struct zsolve_tasks *) user;
+
+    tasks->task(i, tasks->user);
+}
+
+/* Parallel callback for zsolve that runs the tasks in the threads
+ * available to the barvinok_options passed as "data".
+ */
+static void zsolve_parallel(int n, void (*task)(int i, void *user),
+			    void *user, void *data)
+{
+    struct zsolve_tasks tasks = { task, user };
+
+    parallel_for_fn(n, &zsolve_task, &tasks, (struct barvinok_options *) data);
+}
+
+/* Compute the Hilbert basis of the nonnegative solutions of
+ * the homogeneous equalities M, with dim the number of
+ * original (non-slack) variables.
+ * Return NULL if any of the intermediate results does not fit
+ * in a vector_t.
+ * If more than one thread is allowed, then the completion procedure
+ * of zsolve runs in the threads available to options, with a result
+ * that does not depend on the number of threads.
+ * Otherwise, the sequential completion procedure is used, which does
+ * not need to keep all candidate sums of a round in memory.
+ */
+Matrix *ZSOLVE_HILBERT_BASIS(Matrix *M, unsigned dim,
+			     struct barvinok_options *options)
+{
+    int i;
+    Matrix *H;
+    LinearSystem initialsystem;
+    ZSolveMatrix matrix;
+    ZSolveVector rhs;
+    ZSolveContext ctx;
+
+    matrix = Matrix2zsolve(M);
+    if (!matrix)
+	return NULL;
+
+    rhs = createVector(matrix->Height);
+    for (i = 0; i < matrix->Height; i++)
+	rhs[i] = 0;
+
+    initialsystem = createLinearSystem();
+    setLinearSystemMatrix(initialsystem, matrix);
+    deleteMatrix(matrix);
+
+    setLinearSystemRHS(initialsystem, rhs);
+    deleteVector(rhs);
+
+    setLinearSystemLimit(initialsystem, -1, 0, MAXINT, 0);
+    setLinearSystemEquationType(initialsystem, -1, EQUATION_EQUAL, 0);
+
+    ctx = createZSolveContextFromSystem(initialsystem, NULL, 0, 0, NULL, NULL);
+    if (parallel_threads(options) > 1)
+	setZSolveContextParallel(ctx, &zsolve_parallel, options);
+    zsolveSystem(ctx, 0);
+
+    H = ctx->Overflow ? NULL : VectorArray2Matrix(ctx->Homs, dim);
+    deleteZSolveContext(ctx, 1);
+
+    return H;
+}
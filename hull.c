@@ -376,15 +376,23 @@ static Matrix *gbr_cone_hull(Polyhedron *C, Matrix *c, int n_c,
     return vertices;
 }
 
-/* Computes the integer hull of the cone C with the origin removed. */
+/* Computes the integer hull of the cone C with the origin removed.
+ * If the Hilbert basis cannot be computed because its coefficients
+ * are too large for zsolve, then we fall back to BV_HULL_GBR.
+ */
 Matrix *Cone_Integer_Hull(Polyhedron *C, Matrix *candidates,
 			  int n_candidates, struct barvinok_options *options)
 {
+    Matrix *hull;
+
     switch(options->integer_hull) {
     case BV_HULL_GBR:
 	return gbr_cone_hull(C, candidates, n_candidates, options);
     case BV_HULL_HILBERT:
-	return Cone_Hilbert_Integer_Hull(C, options);
+	hull = Cone_Hilbert_Integer_Hull(C, options);
+	if (hull)
+	    return hull;
+	return gbr_cone_hull(C, candidates, n_candidates, options);
     default:
 	assert(0);
     }
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <vector>
 #include <NTL/mat_ZZ.h>
 #include <NTL/vec_ZZ.h>
 #include <barvinok/polylib.h>
@@ -12,6 +13,7 @@
 
 using std::cerr;
 using std::endl;
+using std::vector;
 
 #define ALLOC(type) (type*)malloc(sizeof(type))
 
@@ -248,6 +250,59 @@ evalue *fractional_part(Value *coef, Value denom, int nvar, Polyhedron *PD)
     return EP;
 }
 
+fractional_part_cache::~fractional_part_cache()
+{
+    clear();
+}
+
+void fractional_part_cache::clear()
+{
+    std::map<std::string, evalue *>::iterator i;
+    for (i = cache.begin(); i != cache.end(); ++i)
+	evalue_free(i->second);
+    cache.clear();
+}
+
+/* Return the result of fractional_part(coef, denom, nvar, NULL),
+ * reusing the result of an earlier call with the same normalized
+ * coefficients and denominator, if any.
+ *
+ * Modifies coef argument !
+ */
+evalue *fractional_part_cache::get(Value *coef, Value denom, int nvar)
+{
+    Value m;
+    value_init(m);
+    value_assign(m, denom);
+    normal_mod(coef, nvar+1, &m);
+
+    std::string key;
+    char *str = mpz_get_str(NULL, 10, m);
+    key = str;
+    free(str);
+    for (int i = 0; i < nvar+1; ++i) {
+	str = mpz_get_str(NULL, 10, coef[i]);
+	key += ' ';
+	key += str;
+	free(str);
+    }
+
+    std::map<std::string, evalue *>::iterator i = cache.find(key);
+    if (i != cache.end()) {
+	value_clear(m);
+	return evalue_dup(i->second);
+    }
+
+    evalue *EP = fractional_part(coef, m, nvar, NULL);
+    value_clear(m);
+
+    if (cache.size() >= FRACTIONAL_PART_CACHE_SIZE)
+	clear();
+    cache[key] = evalue_dup(EP);
+
+    return EP;
+}
+
 /* Computes the ceil of the affine expression specified
  * by coef (of length nvar+1) and the denominator denom.
  * If PD is not NULL, then it specifies additional constraints
@@ -267,24 +322,43 @@ evalue *ceiling(Value *coef, Value denom, int nvar, Polyhedron *PD)
     return EP;
 }
 
+static evalue *cached_fractional_part(Value *coef, Value denom, int nvar,
+				       fractional_part_cache *cache)
+{
+    if (cache)
+	return cache->get(coef, denom, nvar);
+    return fractional_part(coef, denom, nvar, NULL);
+}
+
 static evalue *ceil(Value *coef, int len, Value d,
-		    barvinok_options *options)
+		    barvinok_options *options, fractional_part_cache *cache)
 {
     evalue *c;
 
     Vector_Oppose(coef, coef, len);
-    c = fractional_part(coef, d, len-1, NULL);
+    c = cached_fractional_part(coef, d, len-1, cache);
     if (options->lookup_table)
 	evalue_mod2table(c, len-1);
     return c;
 }
 
+/* Compute the lattice point in the unimodular vertex cone at "vertex"
+ * with rays "Rays".
+ * If closed is not NULL, then closed[j] is zero if the facet
+ * opposite ray j is open, in which case the coordinate with respect
+ * to ray j needs to be strictly larger than that of the vertex.
+ */
 void lattice_point_fixed(Value *vertex, Value *vertex_res,
 			 Matrix *Rays, Matrix *Rays_res,
-			 Value *point)
+			 Value *point, const int *closed)
 {
     unsigned dim = Rays->NbRows;
-    if (value_one_p(vertex[dim]))
+    int open = 0;
+    if (closed)
+	for (int j = 0; j < dim; ++j)
+	    if (!closed[j])
+		open = 1;
+    if (value_one_p(vertex[dim]) && !open)
 	Vector_Copy(vertex_res, point, Rays_res->NbColumns);
     else {
 	Matrix *R2 = Matrix_Copy(Rays);
@@ -296,7 +370,12 @@ void lattice_point_fixed(Value *vertex, Value *vertex_res,
 	Vector_Matrix_Product(vertex, inv, lambda->p);
 	Matrix_Free(inv);
 	for (int j = 0; j < dim; ++j)
-	    mpz_cdiv_q(lambda->p[j], lambda->p[j], vertex[dim]);
+	    if (!closed || closed[j])
+		mpz_cdiv_q(lambda->p[j], lambda->p[j], vertex[dim]);
+	    else {
+		mpz_fdiv_q(lambda->p[j], lambda->p[j], vertex[dim]);
+		value_increment(lambda->p[j], lambda->p[j]);
+	    }
 	Vector_Matrix_Product(lambda->p, Rays_res, point);
 	Vector_Free(lambda);
     }
@@ -311,6 +390,97 @@ static Matrix *Matrix_AddRowColumn(Matrix *M)
     return M2;
 }
 
+/* The part of lattice_points_fixed that only depends on the rays.
+ *
+ * Let Rays = H Q, with H the (lower triangular) Hermite normal form
+ * of Rays and Q unimodular.  The cosets of the lattice generated
+ * by the rows of Rays are then represented by k Q, with 0 <= k_i < H_ii.
+ * D is a diagonal matrix with the H_ii on the diagonal,
+ * inv is the inverse of Rays extended with an extra row and column
+ * and QI is Q, extended with a zero column, multiplied by inv.
+ */
+struct lattice_points_cone {
+    Matrix *Rays;
+    Matrix *D;
+    Matrix *inv;
+    Matrix *QI;
+
+    lattice_points_cone(Matrix *Rays);
+    ~lattice_points_cone();
+};
+
+lattice_points_cone::lattice_points_cone(Matrix *Rays)
+{
+    unsigned dim = Rays->NbRows;
+    Matrix *H, *Q, *U;
+
+    this->Rays = Matrix_Copy(Rays);
+
+    left_hermite(Rays, &H, &Q, &U);
+    Matrix_Free(U);
+    D = Matrix_Alloc(dim, dim);
+    for (int i = 0; i < dim; ++i)
+	value_absolute(D->p[i][i], H->p[i][i]);
+    Matrix_Free(H);
+
+    Matrix *R2 = Matrix_AddRowColumn(Rays);
+    inv = Matrix_Alloc(R2->NbRows, R2->NbColumns);
+    int ok = Matrix_Inverse(R2, inv);
+    assert(ok);
+    Matrix_Free(R2);
+
+    Matrix *Q2 = Matrix_Alloc(dim, dim+1);
+    for (int i = 0; i < dim; ++i)
+	Vector_Copy(Q->p[i], Q2->p[i], dim);
+    Matrix_Free(Q);
+    QI = Matrix_Alloc(dim, dim+1);
+    Matrix_Product(Q2, inv, QI);
+    Matrix_Free(Q2);
+}
+
+lattice_points_cone::~lattice_points_cone()
+{
+    Matrix_Free(Rays);
+    Matrix_Free(D);
+    Matrix_Free(inv);
+    Matrix_Free(QI);
+}
+
+/* Return the ray dependent data for Rays, computing it
+ * if it is not available yet.  If the cache is full,
+ * then the oldest element is evicted.
+ */
+lattice_points_cone *lattice_points_cache::get(Matrix *Rays)
+{
+    for (int i = 0; i < cones.size(); ++i) {
+	Matrix *R = cones[i]->Rays;
+	int j;
+	if (R->NbRows != Rays->NbRows || R->NbColumns != Rays->NbColumns)
+	    continue;
+	for (j = 0; j < R->NbRows; ++j)
+	    if (!Vector_Equal(R->p[j], Rays->p[j], R->NbColumns))
+		break;
+	if (j == R->NbRows)
+	    return cones[i];
+    }
+
+    lattice_points_cone *cone = new lattice_points_cone(Rays);
+    if (cones.size() < LATTICE_POINTS_CACHE_SIZE)
+	cones.push_back(cone);
+    else {
+	delete cones[next];
+	cones[next] = cone;
+	next = (next + 1) % LATTICE_POINTS_CACHE_SIZE;
+    }
+    return cone;
+}
+
+lattice_points_cache::~lattice_points_cache()
+{
+    for (int i = 0; i < cones.size(); ++i)
+	delete cones[i];
+}
+
 #define FORALL_COSETS(det,D,i,k)					\
     do {								\
 	Vector *k = Vector_Alloc(D->NbRows+1);				\
@@ -331,14 +501,112 @@ static Matrix *Matrix_AddRowColumn(Matrix *M)
 	Vector_Free(k);						    	\
     } while(0);
 
+/* Compute the lattice point v + lambda * U, with lambda the fractional
+ * coordinates of the current coset computed by lattice_points_fixed.
+ */
+static void coset_point(Vector *lambda, Matrix *Rays_res, Value *vertex,
+			Value *vertex_res, unsigned dim, Value d,
+			Vector *lambda2, Value *point)
+{
+    Vector_Matrix_Product(lambda->p, Rays_res, lambda2->p);
+    for (int j = 0; j < lambda2->Size; ++j)
+	assert(mpz_divisible_p(lambda2->p[j], d));
+    Vector_AntiScale(lambda2->p, lambda2->p, d, lambda2->Size);
+    Vector_Add(lambda2->p, vertex_res, lambda2->p, lambda2->Size);
+    for (int j = 0; j < lambda2->Size; ++j)
+	assert(mpz_divisible_p(lambda2->p[j], vertex[dim]));
+    Vector_AntiScale(lambda2->p, point, vertex[dim], lambda2->Size);
+}
+
+/* Enumerate the cosets of lattice_points_fixed, keeping track of
+ * the residues of the first dim elements of [k 1] T2 modulo m = T2[dim][dim]
+ * in machine words.  Moving to the next coset only changes
+ * a single element of k (apart from the elements that wrap around),
+ * so the residues can be updated incrementally.
+ * Return false if m does not comfortably fit in a machine word,
+ * in which case the caller needs to perform the computations in GMP.
+ */
+static bool lattice_points_word(Value *vertex, Value *vertex_res,
+				Matrix *Rays_res, Matrix *points,
+				unsigned long det, const int *closed,
+				Matrix *D, Matrix *T2, Value d)
+{
+    unsigned dim = D->NbRows;
+    Value m, tmp;
+
+    value_init(m);
+    value_assign(m, T2->p[dim][dim]);
+    if (value_negz_p(m) || mpz_sizeinbase(m, 2) > 62) {
+	value_clear(m);
+	return false;
+    }
+
+    long mod = mpz_get_si(m);
+    vector<long> step(dim * dim);
+    vector<long> wrap(dim * dim);
+    vector<long> r(dim);
+    vector<unsigned long> k(dim, 0);
+
+    value_init(tmp);
+    for (int j = 0; j < dim; ++j)
+	for (int c = 0; c < dim; ++c) {
+	    mpz_fdiv_r(tmp, T2->p[j][c], m);
+	    step[j * dim + c] = mpz_get_si(tmp);
+	    value_decrement(tmp, D->p[j][j]);
+	    value_multiply(tmp, tmp, T2->p[j][c]);
+	    value_oppose(tmp, tmp);
+	    mpz_fdiv_r(tmp, tmp, m);
+	    wrap[j * dim + c] = mpz_get_si(tmp);
+	}
+    for (int c = 0; c < dim; ++c) {
+	mpz_fdiv_r(tmp, T2->p[dim][c], m);
+	r[c] = mpz_get_si(tmp);
+    }
+    value_clear(tmp);
+
+    Vector *lambda = Vector_Alloc(dim+1);
+    Vector *lambda2 = Vector_Alloc(Rays_res->NbColumns);
+    value_assign(lambda->p[dim], m);
+    for (unsigned long i = 0; i < det; ++i) {
+	if (i)
+	    for (int j = dim-1; j >= 0; --j) {
+		const long *delta;
+		if (++k[j] == mpz_get_ui(D->p[j][j])) {
+		    k[j] = 0;
+		    delta = &wrap[j * dim];
+		} else
+		    delta = &step[j * dim];
+		for (int c = 0; c < dim; ++c) {
+		    r[c] += delta[c];
+		    if (r[c] >= mod)
+			r[c] -= mod;
+		}
+		if (k[j] != 0)
+		    break;
+	    }
+	for (int c = 0; c < dim; ++c)
+	    if (closed && !closed[c] && r[c] == 0)
+		value_set_si(lambda->p[c], mod);
+	    else
+		value_set_si(lambda->p[c], r[c]);
+	coset_point(lambda, Rays_res, vertex, vertex_res, dim, d,
+		    lambda2, points->p[i]);
+    }
+    Vector_Free(lambda);
+    Vector_Free(lambda2);
+    value_clear(m);
+
+    return true;
+}
+
 /* Compute the lattice points in the vertex cone at "values" with rays "rays".
  * The lattice points are returned in "vertex".
  *
- * Rays has the generators as rows and so does W.
- * We first compute { m-v, u_i^* } with m = k W, where k runs through
- * the cosets.
+ * Rays has the generators as rows and so does Q.
+ * We first compute { m-v, u_i^* } with m = k Q, where k runs through
+ * the cosets (see lattice_points_cone).
  * We compute
- * [k 1] [ d1*W  0 ] [  U'  0 ] = [k 1] T2
+ * [k 1] [ d1*Q  0 ] [  U'  0 ] = [k 1] T2
  *       [ -v   d1 ] [  0  d2 ]
  * where d1 and d2 are the denominators of v and U^{-1}=U'/d2.
  * Then  lambda = { k } (componentwise)
@@ -352,23 +620,35 @@ static Matrix *Matrix_AddRowColumn(Matrix *M)
  * can be at most d1, since it is integer if v = 0.
  * The denominator of v + lambda2 is 1.
  *
+ * The first dim rows of T2 only depend on the rays (up to a factor d1)
+ * and may be taken from "cache", if it is not NULL.
+ * The cosets are enumerated in word-size arithmetic, if possible.
+ *
+ * The facet opposite ray j is open if closed is not NULL and closed[j]
+ * is zero.
+ *
  * The _res variants of the input variables may have been multiplied with
  * a (list of) nonorthogonal vector(s) and may therefore have fewer columns
  * than their original counterparts.
  */
 void lattice_points_fixed(Value *vertex, Value *vertex_res,
 			  Matrix *Rays, Matrix *Rays_res, Matrix *points,
-			  unsigned long det)
+			  unsigned long det, const int *closed,
+			  lattice_points_cache *cache)
 {
     unsigned dim = Rays->NbRows;
     if (det == 1) {
 	lattice_point_fixed(vertex, vertex_res, Rays, Rays_res,
-			    points->p[0]);
+			    points->p[0], closed);
 	return;
     }
-    Matrix *U, *W, *D;
-    Smith(Rays, &U, &W, &D);
-    Matrix_Free(U);
+    lattice_points_cone *cone;
+    if (cache)
+	cone = cache->get(Rays);
+    else
+	cone = new lattice_points_cone(Rays);
+    Matrix *D = cone->D;
+    Matrix *inv = cone->inv;
 
     /* Sanity check */
     unsigned long det2 = 1;
@@ -376,42 +656,37 @@ void lattice_points_fixed(Value *vertex, Value *vertex_res,
 	det2 *= mpz_get_ui(D->p[i][i]);
     assert(det == det2);
 
-    Matrix *T = Matrix_Alloc(W->NbRows+1, W->NbColumns+1);
-    for (int i = 0; i < W->NbRows; ++i)
-	Vector_Scale(W->p[i], T->p[i], vertex[dim], W->NbColumns);
-    Matrix_Free(W);
-    Vector_Oppose(vertex, T->p[dim], dim);
-    value_assign(T->p[dim][dim], vertex[dim]);
-
-    Matrix *R2 = Matrix_AddRowColumn(Rays);
-    Matrix *inv = Matrix_Alloc(R2->NbRows, R2->NbColumns);
-    int ok = Matrix_Inverse(R2, inv);
-    assert(ok);
-    Matrix_Free(R2);
-
     Matrix *T2 = Matrix_Alloc(dim+1, dim+1);
-    Matrix_Product(T, inv, T2);
-    Matrix_Free(T);
+    for (int i = 0; i < dim; ++i)
+	Vector_Scale(cone->QI->p[i], T2->p[i], vertex[dim], dim+1);
+    Vector *v = Vector_Alloc(dim+1);
+    Vector_Oppose(vertex, v->p, dim);
+    value_assign(v->p[dim], vertex[dim]);
+    Vector_Matrix_Product(v->p, inv, T2->p[dim]);
+    Vector_Free(v);
+
+    if (!lattice_points_word(vertex, vertex_res, Rays_res, points, det,
+			     closed, D, T2, inv->p[dim][dim])) {
+	Vector *lambda = Vector_Alloc(dim+1);
+	Vector *lambda2 = Vector_Alloc(Rays_res->NbColumns);
+	FORALL_COSETS(det, D, i, k)
+	    Vector_Matrix_Product(k->p, T2, lambda->p);
+	    for (int j = 0; j < dim; ++j)
+		if (!closed || closed[j])
+		    mpz_fdiv_r(lambda->p[j], lambda->p[j], lambda->p[dim]);
+		else {
+		    mpz_cdiv_r(lambda->p[j], lambda->p[j], lambda->p[dim]);
+		    value_addto(lambda->p[j], lambda->p[j], lambda->p[dim]);
+		}
+	    coset_point(lambda, Rays_res, vertex, vertex_res, dim,
+			inv->p[dim][dim], lambda2, points->p[i]);
+	END_FORALL_COSETS
+	Vector_Free(lambda);
+	Vector_Free(lambda2);
+    }
 
-    Vector *lambda = Vector_Alloc(dim+1);
-    Vector *lambda2 = Vector_Alloc(Rays_res->NbColumns);
-    FORALL_COSETS(det, D, i, k)
-	Vector_Matrix_Product(k->p, T2, lambda->p);
-	for (int j = 0; j < dim; ++j)
-	    mpz_fdiv_r(lambda->p[j], lambda->p[j], lambda->p[dim]);
-	Vector_Matrix_Product(lambda->p, Rays_res, lambda2->p);
-	for (int j = 0; j < lambda2->Size; ++j)
-	    assert(mpz_divisible_p(lambda2->p[j], inv->p[dim][dim]));
-	Vector_AntiScale(lambda2->p, lambda2->p, inv->p[dim][dim], lambda2->Size);
-	Vector_Add(lambda2->p, vertex_res, lambda2->p, lambda2->Size);
-	for (int j = 0; j < lambda2->Size; ++j)
-	    assert(mpz_divisible_p(lambda2->p[j], vertex[dim]));
-	Vector_AntiScale(lambda2->p, points->p[i], vertex[dim], lambda2->Size);
-    END_FORALL_COSETS
-    Vector_Free(lambda);
-    Vector_Free(lambda2);
-    Matrix_Free(D);
-    Matrix_Free(inv);
+    if (!cache)
+	delete cone;
 
     Matrix_Free(T2);
 }
@@ -428,7 +703,8 @@ void lattice_points_fixed(Value *vertex, Value *vertex_res,
  */
 static evalue **lattice_point_fractional(const mat_ZZ& rays, vec_ZZ& lambda,
 					 Matrix *V,
-					 unsigned long det)
+					 unsigned long det,
+					 fractional_part_cache *cache)
 {
     unsigned nparam = V->NbColumns-2;
     evalue **E = new evalue *[det];
@@ -466,7 +742,8 @@ static evalue **lattice_point_fractional(const mat_ZZ& rays, vec_ZZ& lambda,
 	for (int i = 0; i < L->NbRows; ++i) {
 	    evalue *f;
 	    Vector_Oppose(L->p[i], L->p[i], nparam+1);
-	    f = fractional_part(L->p[i], V->p[i][nparam+1], nparam, NULL);
+	    f = cached_fractional_part(L->p[i], V->p[i][nparam+1], nparam,
+				       cache);
 	    zz2value(p[i], tmp);
 	    evalue_mul(f, tmp);
 	    eadd(f, EP);
@@ -510,7 +787,7 @@ static evalue **lattice_point_fractional(const mat_ZZ& rays, vec_ZZ& lambda,
 		evalue *f;
 		Vector_Oppose(L->p[j], row->p, nparam+1);
 		value_addmul(row->p[nparam], L->p[j][nparam+1], lambda->p[j]);
-		f = fractional_part(row->p, denom, nparam, NULL);
+		f = cached_fractional_part(row->p, denom, nparam, cache);
 		zz2value(p[j], tmp);
 		evalue_mul(f, tmp);
 		eadd(f, E[i]);
@@ -538,9 +815,11 @@ static evalue **lattice_point_fractional(const mat_ZZ& rays, vec_ZZ& lambda,
 static evalue **lattice_point(const mat_ZZ& rays, vec_ZZ& lambda,
 			      Param_Vertices *V,
 			      unsigned long det,
-			      barvinok_options *options)
+			      barvinok_options *options,
+			      fractional_part_cache *cache)
 {
-    evalue **lp = lattice_point_fractional(rays, lambda, V->Vertex, det);
+    evalue **lp = lattice_point_fractional(rays, lambda, V->Vertex, det,
+					   cache);
     if (options->lookup_table) {
 	for (int i = 0; i < det; ++i)
 	    evalue_mod2table(lp[i], V->Vertex->NbColumns-2);
@@ -574,9 +853,13 @@ Matrix *relative_coordinates(Param_Vertices *V, Matrix *basis)
  * coordinate i of this lattice point is equal to
  *
  *	    num[i] + E_vertex[i]
+ *
+ * If cache is not NULL, then it is used to share the fractional parts
+ * with other calls.
  */
 void lattice_point(Param_Vertices *V, const mat_ZZ& rays, vec_ZZ& num, 
-		   evalue **E_vertex, barvinok_options *options)
+		   evalue **E_vertex, barvinok_options *options,
+		   fractional_part_cache *cache)
 {
     unsigned nparam = V->Vertex->NbColumns - 2;
     unsigned dim = rays.NumCols();
@@ -606,7 +889,7 @@ void lattice_point(Param_Vertices *V, const mat_ZZ& rays, vec_ZZ& num,
 	evalue **remainders = new evalue *[dim];
 	for (int i = 0; i < dim; ++i)
 	    remainders[i] = ceil(L->p[i], nparam+1, V->Vertex->p[0][nparam+1],
-				 options);
+				 options, cache);
 	Matrix_Free(L);
 
 
@@ -693,10 +976,12 @@ static int lattice_point_fixed(Param_Vertices* V, const mat_ZZ& rays,
  * of the unimodular cone i shifted to the parametric vertex V.
  *
  * The result is returned in term.
+ * If cache is not NULL, then it is used to share the fractional parts
+ * with other calls.
  */
 void lattice_point(Param_Vertices* V, const mat_ZZ& rays, vec_ZZ& lambda,
     term_info* term, unsigned long det,
-    barvinok_options *options)
+    barvinok_options *options, fractional_part_cache *cache)
 {
     unsigned nparam = V->Vertex->NbColumns - 2;
     mat_ZZ vertex;
@@ -708,7 +993,7 @@ void lattice_point(Param_Vertices* V, const mat_ZZ& rays, vec_ZZ& lambda,
 	return;
 
     if (det != 1 || value_notone_p(V->Vertex->p[0][nparam+1])) {
-	term->E = lattice_point(rays, lambda, V, det, options);
+	term->E = lattice_point(rays, lambda, V, det, options, cache);
 	return;
     }
     for (int i = 0; i < V->Vertex->NbRows; ++i) {
@@ -17,6 +17,9 @@ Matrix *relative_coordinates(Param_Vertices *V, Matrix *basis);
 
 #if defined(__cplusplus)
 
+#include <map>
+#include <string>
+#include <vector>
 #include <NTL/vec_ZZ.h>
 #include <NTL/mat_ZZ.h>
 
@@ -24,16 +27,51 @@ using namespace NTL;
 
 struct barvinok_options;
 
+#define LATTICE_POINTS_CACHE_SIZE	16
+
+struct lattice_points_cone;
+
+/* The ray dependent data of lattice_points_fixed for
+ * (at most LATTICE_POINTS_CACHE_SIZE) recently used ray matrices.
+ */
+struct lattice_points_cache {
+    std::vector<lattice_points_cone *> cones;
+    int next;
+
+    lattice_points_cache() : next(0) {}
+    ~lattice_points_cache();
+    lattice_points_cone *get(Matrix *Rays);
+};
+
+#define FRACTIONAL_PART_CACHE_SIZE	1024
+
+/* Memoized results of fractional_part (without additional constraints),
+ * keyed on the coefficients and the denominator after normalization
+ * by normal_mod.  The fractional parts of the vertices of a parametric
+ * polytope are often shared by several of the cones at a vertex and
+ * by vertices with the same denominator.
+ * The cache is cleared when it reaches FRACTIONAL_PART_CACHE_SIZE elements.
+ */
+struct fractional_part_cache {
+    std::map<std::string, evalue *> cache;
+
+    ~fractional_part_cache();
+    evalue *get(Value *coef, Value denom, int nvar);
+    void clear();
+};
+
 evalue *multi_monom(vec_ZZ& p);
 int normal_mod(Value *coef, int len, Value *m);
 void lattice_point_fixed(Value *vertex, Value *vertex_res,
 			 Matrix *Rays, Matrix *Rays_res,
-			 Value *point);
+			 Value *point, const int *closed = NULL);
 void lattice_points_fixed(Value *vertex, Value *vertex_res,
 			  Matrix *Rays, Matrix *Rays_res, Matrix *points,
-			  unsigned long det);
+			  unsigned long det, const int *closed = NULL,
+			  lattice_points_cache *cache = NULL);
 void lattice_point(Param_Vertices *V, const mat_ZZ& rays, vec_ZZ& num, 
-		   evalue **E_vertex, barvinok_options *options);
+		   evalue **E_vertex, barvinok_options *options,
+		   fractional_part_cache *cache = NULL);
 
 /* This structure encodes the power of the term in a rational generating function.
  * 
@@ -48,7 +86,7 @@ struct term_info {
 
 void lattice_point(Param_Vertices* V, const mat_ZZ& rays, vec_ZZ& lambda,
     term_info* term, unsigned long det,
-    barvinok_options *options);
+    barvinok_options *options, fractional_part_cache *cache = NULL);
 
 #endif
 
@@ -10,6 +10,7 @@
 #include "param_util.h"
 #include "reduce_domain.h"
 #include "vertex_cone.h"
+#include "vector_int_hash_map.h"
 #include "config.h"
 
 using std::cerr;
@@ -17,54 +18,6 @@ using std::ostream;
 using std::endl;
 using std::vector;
 
-#if defined HAVE_UNORDERED_MAP
-
-#include <unordered_map>
-
-#define HASH_MAP std::unordered_map
-
-namespace std
-{
-        template<> struct hash< std::vector<int> >
-        {
-                size_t operator()( const std::vector<int>& x ) const
-                {
-			unsigned long __h = 0;
-			for (int i = 0; i < x.size(); ++i)
-			    __h = 5 * __h + x[i];
-                        return size_t(__h);
-                }
-        };
-}
-
-#elif defined HAVE_GNUCXX_HASHMAP
-
-#include <ext/hash_map>
-
-#define HASH_MAP __gnu_cxx::hash_map
-
-namespace __gnu_cxx
-{
-        template<> struct hash< std::vector<int> >
-        {
-                size_t operator()( const std::vector<int>& x ) const
-                {
-			unsigned long __h = 0;
-			for (int i = 0; i < x.size(); ++i)
-			    __h = 5 * __h + x[i];
-                        return size_t(__h);
-                }
-        };
-}
-
-#else
-
-#warning "no hash_map available"
-#include <map>
-#define HASH_MAP std::map
-
-#endif
-
 #define ALLOC(type) (type*)malloc(sizeof(type))
 #define ALLOCN(type,n) (type*)malloc((n) * sizeof(type))
 
@@ -461,6 +461,8 @@ struct indicator_constructor : public signed_cone_consumer,
     int nbV;
     int pos;
     int n;
+    /* fractional parts shared by the cones at all vertices */
+    fractional_part_cache fp_cache;
 
     indicator_constructor(unsigned dim, Param_Polyhedron *PP, Matrix *T) :
 		vertex_decomposer(PP, *this), T(T), nbV(PP->nbV) {
@@ -495,7 +497,7 @@ void indicator_constructor::handle(const signed_cone& sc, barvinok_options *opti
     term->sign = sc.sign;
     terms[vert].push_back(term);
 
-    lattice_point(V, sc.rays, vertex, term->vertex, options);
+    lattice_point(V, sc.rays, vertex, term->vertex, options, &fp_cache);
 
     term->den = sc.rays;
     for (int r = 0; r < dim; ++r) {
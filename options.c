@@ -13,6 +13,35 @@ void barvinok_stats_clear(struct barvinok_stats *stats)
     memset(stats, 0, sizeof(*stats));
 }
 
+/* Add the statistics in src to those in dst.
+ * The maximal sizes of the pending cones are combined by taking the maximum.
+ */
+void barvinok_stats_merge(struct barvinok_stats *dst,
+			  struct barvinok_stats *src)
+{
+    dst->base_cones += src->base_cones;
+    dst->volume_simplices += src->volume_simplices;
+    dst->topcom_empty_chambers += src->topcom_empty_chambers;
+    dst->topcom_chambers += src->topcom_chambers;
+    dst->topcom_distinct_chambers += src->topcom_distinct_chambers;
+    dst->gbr_solved_lps += src->gbr_solved_lps;
+    dst->bernoulli_sums += src->bernoulli_sums;
+    dst->lll_exact += src->lll_exact;
+    dst->lll_fp += src->lll_fp;
+    dst->lll_fp_fallbacks += src->lll_fp_fallbacks;
+    dst->svp_reductions += src->svp_reductions;
+    dst->svp_shorter += src->svp_shorter;
+    if (src->decompose_max_cones > dst->decompose_max_cones)
+	dst->decompose_max_cones = src->decompose_max_cones;
+    if (src->decompose_max_bytes > dst->decompose_max_bytes)
+	dst->decompose_max_bytes = src->decompose_max_bytes;
+    dst->modular_primes += src->modular_primes;
+    dst->modular_fallbacks += src->modular_fallbacks;
+    dst->enumerate_e_memo_hits += src->enumerate_e_memo_hits;
+    dst->enumerate_e_memo_misses += src->enumerate_e_memo_misses;
+    dst->hilbert_int64 += src->hilbert_int64;
+}
+
 void barvinok_stats_print(struct barvinok_stats *stats, FILE *out)
 {
     fprintf(out, "Base cones: %ld\n", stats->base_cones);
@@ -29,6 +58,37 @@ void barvinok_stats_print(struct barvinok_stats *stats, FILE *out)
 	fprintf(out, "LPs solved during GBR: %ld\n", stats->gbr_solved_lps);
     if (stats->bernoulli_sums)
 	fprintf(out, "Bernoulli sums: %ld\n", stats->bernoulli_sums);
+    if (stats->lll_fp) {
+	fprintf(out, "Exact LLL reductions: %ld\n", stats->lll_exact);
+	fprintf(out, "Floating point LLL reductions: %ld\n", stats->lll_fp);
+	fprintf(out, "Floating point LLL fallbacks: %ld\n",
+		stats->lll_fp_fallbacks);
+    }
+    if (stats->decompose_max_cones) {
+	fprintf(out, "Maximal number of pending cones: %ld\n",
+		stats->decompose_max_cones);
+	fprintf(out, "Maximal size of pending cones: %ld\n",
+		stats->decompose_max_bytes);
+    }
+    if (stats->svp_reductions) {
+	fprintf(out, "Shortest vector searches: %ld\n", stats->svp_reductions);
+	fprintf(out, "Shorter than LLL vectors: %ld\n", stats->svp_shorter);
+    }
+    if (stats->modular_primes) {
+	fprintf(out, "Primes used in modular counting: %ld\n",
+		stats->modular_primes);
+	fprintf(out, "Modular counting fallbacks: %ld\n",
+		stats->modular_fallbacks);
+    }
+    if (stats->enumerate_e_memo_hits || stats->enumerate_e_memo_misses) {
+	fprintf(out, "Memoized existential subproblems reused: %ld\n",
+		stats->enumerate_e_memo_hits);
+	fprintf(out, "Existential subproblems computed: %ld\n",
+		stats->enumerate_e_memo_misses);
+    }
+    if (stats->hilbert_int64)
+	fprintf(out, "Hilbert bases computed on 64-bit integers: %ld\n",
+		stats->hilbert_int64);
 }
 
 static struct isl_arg_choice approx[] = {
@@ -127,6 +187,17 @@ static int int_init_zero(void *user)
 	*((int *)user) = 0;
 	return 0;
 }
+static int ptr_init_null(void *user)
+{
+	*((void **)user) = NULL;
+	return 0;
+}
+static void file_close(void *user)
+{
+	FILE **file = (FILE **)user;
+	if (*file)
+		fclose(*file);
+}
 static void print_version(void)
 {
 	printf("%s", barvinok_version());
@@ -145,6 +216,21 @@ static struct isl_arg_choice specialization[] = {
 	{"df",		BV_SPECIALIZATION_DF},
 	{"random",	BV_SPECIALIZATION_RANDOM},
 	{"todd",	BV_SPECIALIZATION_TODD},
+	{"modular",	BV_SPECIALIZATION_MODULAR},
+	{0}
+};
+
+static struct isl_arg_choice lll[] = {
+	{"exact",	BV_LLL_EXACT},
+	{"fp",		BV_LLL_FP},
+	{"auto",	BV_LLL_AUTO},
+	{0}
+};
+
+static struct isl_arg_choice decompose_order[] = {
+	{"dfs",		BV_DECOMPOSE_DFS},
+	{"bfs",		BV_DECOMPOSE_BFS},
+	{"det",		BV_DECOMPOSE_DET},
 	{0}
 };
 
@@ -183,9 +269,7 @@ static struct isl_arg_choice summation[] = {
 
 static struct isl_arg_choice chambers[] = {
 	{"polylib",		BV_CHAMBERS_POLYLIB},
-#ifdef POINTS2TRIANGS_PATH
 	{"topcom",		BV_CHAMBERS_TOPCOM},
-#endif
 	{"isl",			BV_CHAMBERS_ISL},
 	{0}
 };
@@ -209,11 +293,25 @@ ISL_ARG_LONG(struct barvinok_options, LLL_a, 0, "lll-reduction-num", 1,
 	"LLL reduction parameter numerator")
 ISL_ARG_LONG(struct barvinok_options, LLL_b, 0, "lll-reduction-den", 1,
 	"LLL reduction parameter denominator")
+ISL_ARG_CHOICE(struct barvinok_options, LLL_engine, 0, "lll", lll,
+	BV_LLL_EXACT, "LLL reduction engine to use in cone decomposition")
+ISL_ARG_ULONG(struct barvinok_options, svp_dimension, 0, "svp-dimension", 0,
+	"maximal dimension of cones for which a shortest vector is computed "
+	"in cone decomposition (BKZ block size for larger cones)")
 ISL_ARG_CHOICE(struct barvinok_options, incremental_specialization,
 	0, "specialization", specialization, DEFAULT_SPECIALIZATION, NULL)
 ISL_ARG_ULONG(struct barvinok_options, max_index, 0, "index", 1,
        "maximal index of simple cones in decomposition")
 ISL_ARG_BOOL(struct barvinok_options, primal, 0, "primal", 0, NULL)
+ISL_ARG_BOOL(struct barvinok_options, half_open, 0, "half-open", 0,
+	"perform primal decomposition into half-open cones")
+ISL_ARG_CHOICE(struct barvinok_options, decompose_order, 0,
+	"decomposition-order", decompose_order, BV_DECOMPOSE_DFS,
+	"order in which cones are split during decomposition")
+ISL_ARG_ULONG(struct barvinok_options, decompose_memory, 0,
+	"decomposition-memory", 0,
+	"maximal memory (in bytes) of cones waiting to be split "
+	"before switching to depth first order (0 for no limit)")
 ISL_ARG_BOOL(struct barvinok_options, lookup_table, 0, "table", 0, NULL)
 ISL_ARG_USER(struct barvinok_options, count_sample_infinite, &int_init_one, NULL)
 ISL_ARG_USER(struct barvinok_options, try_Delaunay_triangulation, &int_init_zero, NULL)
@@ -228,6 +326,22 @@ ISL_ARG_CHOICE(struct barvinok_options, chambers, 0, "chamber-decomposition",
 ISL_ARG_CHOICE(struct barvinok_options, integer_hull, 0, "integer-hull",
 	hull, BV_HULL_GBR, NULL)
 ISL_ARG_USER(struct barvinok_options, gbr_only_first, &int_init_zero, NULL)
+ISL_ARG_ULONG(struct barvinok_options, enumerate_e_memo, 0,
+	"existential-memo", 1024,
+	"maximal number of memoized subproblems during the enumeration "
+	"of existentially quantified polytopes (0 to disable)")
+ISL_ARG_ULONG(struct barvinok_options, threads, 0, "threads", 1,
+	"maximal number of threads")
+ISL_ARG_ULONG(struct barvinok_options, cone_queue, 0, "cone-queue", 1024,
+	"maximal number of cones waiting to be counted "
+	"when running in multiple threads")
+ISL_ARG_STR(struct barvinok_options, save_cones, 0, "save-cones", "file",
+	NULL, "save cone decompositions to file")
+ISL_ARG_STR(struct barvinok_options, load_cones, 0, "load-cones", "file",
+	NULL, "load cone decompositions saved by --save-cones from file")
+ISL_ARG_USER(struct barvinok_options, cone_file, &ptr_init_null, &file_close)
+ISL_ARG_USER(struct barvinok_options, enumerate_e_memo_table, &ptr_init_null,
+	NULL)
 ISL_ARG_BOOL(struct barvinok_options, print_stats, 0, "print-stats", 0, NULL)
 ISL_ARG_BOOL(struct barvinok_options, verbose, 0, "verbose", 0, NULL)
 ISL_ARG_VERSION(print_version)
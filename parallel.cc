@@ -0,0 +1,214 @@
+#include <assert.h>
+#include <exception>
+#include <vector>
+#include <barvinok/options.h>
+#include "parallel.h"
+#include "config.h"
+
+#if defined(HAVE_PTHREAD) && defined(NTL_THREADS) && \
+    defined(HAVE_THREAD_SAFE_POLYLIB)
+#define USE_PARALLEL_FOR
+#include <pthread.h>
+#endif
+
+using std::vector;
+
+/* parallel_for calls body.run(i, options) for each i in [0, n).
+ * If options->threads is larger than one, then the iterations
+ * are distributed over several threads, each of which picks
+ * the next iteration as soon as it has finished the previous one.
+ * The order in which the iterations are executed is therefore arbitrary
+ * and the caller is responsible for combining the results of
+ * the iterations in a deterministic way.
+ *
+ * The total number of threads running at any given time,
+ * including those started by nested calls and by the cone pipeline,
+ * is kept within options->threads.  If no additional threads
+ * are available, then the iterations are executed in the calling thread.
+ *
+ * The additional threads get a private copy of options with
+ * their own statistics, which are added to options->stats at the end.
+ * Since the cone file is shared, the iterations are always performed
+ * sequentially if cones are being saved or loaded.
+ *
+ * If an iteration throws an exception, then the remaining iterations
+ * are skipped and the first such exception is rethrown
+ * in the calling thread.
+ *
+ * Since the iterations typically call PolyLib and NTL, additional
+ * threads are only used if both were built to be thread-safe.
+ * Otherwise, options->threads is treated as if it were one.
+ */
+
+#ifdef USE_PARALLEL_FOR
+
+unsigned long parallel_threads(barvinok_options *options)
+{
+    return options->threads > 1 ? options->threads : 1;
+}
+
+/* The number of additional threads that are currently running. */
+static pthread_mutex_t budget_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long threads_in_use = 0;
+
+/* Reserve up to "wanted" threads on top of the calling thread and
+ * return the number of threads that were actually reserved.
+ */
+unsigned long parallel_reserve_threads(unsigned long wanted,
+				       barvinok_options *options)
+{
+    unsigned long n = 0;
+
+    pthread_mutex_lock(&budget_lock);
+    if (options->threads > 1 + threads_in_use) {
+	n = options->threads - 1 - threads_in_use;
+	if (n > wanted)
+	    n = wanted;
+	threads_in_use += n;
+    }
+    pthread_mutex_unlock(&budget_lock);
+
+    return n;
+}
+
+void parallel_release_threads(unsigned long n)
+{
+    pthread_mutex_lock(&budget_lock);
+    assert(threads_in_use >= n);
+    threads_in_use -= n;
+    pthread_mutex_unlock(&budget_lock);
+}
+
+/* NTL_THREADS requires C++11, so std::exception_ptr is available here. */
+struct parallel_state {
+    parallel_body& body;
+    int n;
+    int next;
+    std::exception_ptr error;
+    pthread_mutex_t lock;
+
+    parallel_state(int n, parallel_body& body) :
+		body(body), n(n), next(0) {
+	pthread_mutex_init(&lock, NULL);
+    }
+    ~parallel_state() {
+	pthread_mutex_destroy(&lock);
+    }
+    void run(barvinok_options *options);
+};
+
+void parallel_state::run(barvinok_options *options)
+{
+    for (;;) {
+	int i;
+
+	pthread_mutex_lock(&lock);
+	if (error || next >= n) {
+	    pthread_mutex_unlock(&lock);
+	    break;
+	}
+	i = next++;
+	pthread_mutex_unlock(&lock);
+
+	try {
+	    body.run(i, options);
+	} catch (...) {
+	    pthread_mutex_lock(&lock);
+	    if (!error)
+		error = std::current_exception();
+	    pthread_mutex_unlock(&lock);
+	}
+    }
+}
+
+struct parallel_worker {
+    parallel_state *state;
+    barvinok_options options;
+    barvinok_stats stats;
+    pthread_t thread;
+};
+
+static void *run_worker(void *user)
+{
+    parallel_worker *worker = (parallel_worker *) user;
+    worker->state->run(&worker->options);
+    return NULL;
+}
+
+void parallel_for(int n, parallel_body& body, barvinok_options *options)
+{
+    unsigned long extra = 0;
+
+    if (n > 1 && !options->save_cones && !options->load_cones)
+	extra = parallel_reserve_threads(n - 1, options);
+    if (extra == 0) {
+	for (int i = 0; i < n; ++i)
+	    body.run(i, options);
+	return;
+    }
+
+    parallel_state state(n, body);
+    vector<parallel_worker> workers(extra);
+    for (int i = 0; i < extra; ++i) {
+	workers[i].state = &state;
+	workers[i].options = *options;
+	barvinok_stats_clear(&workers[i].stats);
+	workers[i].options.stats = &workers[i].stats;
+	int r = pthread_create(&workers[i].thread, NULL, &run_worker,
+				&workers[i]);
+	assert(r == 0);
+    }
+    state.run(options);
+    for (int i = 0; i < extra; ++i) {
+	pthread_join(workers[i].thread, NULL);
+	barvinok_stats_merge(options->stats, &workers[i].stats);
+    }
+    parallel_release_threads(extra);
+
+    if (state.error)
+	std::rethrow_exception(state.error);
+}
+
+#else
+
+unsigned long parallel_threads(barvinok_options *options)
+{
+    return 1;
+}
+
+unsigned long parallel_reserve_threads(unsigned long wanted,
+				       barvinok_options *options)
+{
+    return 0;
+}
+
+void parallel_release_threads(unsigned long n)
+{
+}
+
+void parallel_for(int n, parallel_body& body, barvinok_options *options)
+{
+    for (int i = 0; i < n; ++i)
+	body.run(i, options);
+}
+
+#endif
+
+struct parallel_fn_body : public parallel_body {
+    void (*fn)(int i, struct barvinok_options *options, void *user);
+    void *user;
+
+    parallel_fn_body(void (*fn)(int, struct barvinok_options *, void *),
+		     void *user) : fn(fn), user(user) {}
+    virtual void run(int i, barvinok_options *options) {
+	fn(i, options, user);
+    }
+};
+
+void parallel_for_fn(int n,
+	void (*fn)(int i, struct barvinok_options *options, void *user),
+	void *user, struct barvinok_options *options)
+{
+    parallel_fn_body body(fn, user);
+    parallel_for(n, body, options);
+}
@@ -0,0 +1,40 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <barvinok/options.h>
+
+#if defined(__cplusplus)
+
+/* The body of a loop executed by parallel_for.
+ * run may be called concurrently for different values of i,
+ * each time with options that may only be used by the calling thread.
+ */
+struct parallel_body {
+    virtual void run(int i, barvinok_options *options) = 0;
+    virtual ~parallel_body() {}
+};
+
+void parallel_for(int n, parallel_body& body, barvinok_options *options);
+
+extern "C" {
+#endif
+
+/* The maximal total number of threads that may be used,
+ * i.e., options->threads if threads are supported and one otherwise.
+ */
+unsigned long parallel_threads(struct barvinok_options *options);
+unsigned long parallel_reserve_threads(unsigned long wanted,
+				       struct barvinok_options *options);
+void parallel_release_threads(unsigned long n);
+/* A version of parallel_for for use from C, with body fn.
+ * fn should not throw any exceptions.
+ */
+void parallel_for_fn(int n,
+	void (*fn)(int i, struct barvinok_options *options, void *user),
+	void *user, struct barvinok_options *options);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -111,14 +111,6 @@ Param_Domain *Param_Polyhedron_Facet(Param_Polyhedron *PP, Param_Domain *D,
     return FD;
 }
 
-#ifndef POINTS2TRIANGS_PATH
-Param_Polyhedron *TC_P2PP(Polyhedron *P, Polyhedron *C,
-			  struct barvinok_options *options)
-{
-    return NULL;
-}
-#endif
-
 Param_Polyhedron *Polyhedron2Param_Polyhedron(Polyhedron *P, Polyhedron *C,
 					      struct barvinok_options *options)
 {
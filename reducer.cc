@@ -19,7 +19,14 @@ void np_base::handle(const signed_cone& sc, barvinok_options *options)
 {
     assert(sc.rays.NumRows() == dim);
     factor.n *= sc.sign;
-    handle(sc.rays, current_vertex, factor, sc.det, options);
+    closed = sc.closed;
+    try {
+	handle(sc.rays, current_vertex, factor, sc.det, options);
+    } catch (...) {
+	closed = NULL;
+	throw;
+    }
+    closed = NULL;
     factor.n *= sc.sign;
 }
 
@@ -110,23 +117,23 @@ struct dpoly_r_scanner {
     const dpoly * const *num;
     int n;
     int dim;
-    dpoly_r_term_list::iterator *iter;
+    int *iter;
     vector<int> powers;
     vec_ZZ coeff;
 
     dpoly_r_scanner(const dpoly * const *num, int n, const dpoly_r *rc, int dim)
 		    : rc(rc), num(num), n(n), dim(dim), powers(dim, 0) {
 	coeff.SetLength(n);
-	iter = new dpoly_r_term_list::iterator[rc->len];
+	iter = new int[rc->len];
 	for (int i = 0; i < rc->len; ++i) {
 	    int k;
 	    for (k = 0; k < n; ++k)
 		if (value_notzero_p(num[k]->coeff->p[rc->len-1-i]))
 		    break;
 	    if (k < n)
-		iter[i] = rc->c[i].begin();
+		iter[i] = 0;
 	    else
-		iter[i] = rc->c[i].end();
+		iter[i] = rc->c[i].size();
 	}
     }
     bool next() {
@@ -134,16 +141,18 @@ struct dpoly_r_scanner {
 	int len = 0;
 
 	for (int i = 0; i < rc->len; ++i) {
-	    if (iter[i] == rc->c[i].end())
+	    if (iter[i] == rc->c[i].size())
 		continue;
 	    if (!len) {
 		pos = new int[rc->len];
 		pos[len++] = i;
 	    } else {
-		if ((*iter[i])->powers < (*iter[pos[0]])->powers) {
+		int r = dpoly_r_term_list::cmp(rc->c[i].powers(iter[i]),
+				rc->c[pos[0]].powers(iter[pos[0]]), dim);
+		if (r < 0) {
 		    pos[0] = i;
 		    len = 1;
-		} else if ((*iter[i])->powers == (*iter[pos[0]])->powers)
+		} else if (r == 0)
 		    pos[len++] = i;
 	    }
 	}
@@ -151,16 +160,17 @@ struct dpoly_r_scanner {
 	if (!len)
 	    return false;
 
-	powers = (*iter[pos[0]])->powers;
+	const int *p = rc->c[pos[0]].powers(iter[pos[0]]);
+	powers.assign(p, p + dim);
 	for (int k = 0; k < n; ++k) {
 	    value2zz(num[k]->coeff->p[rc->len-1-pos[0]], tmp);
-	    mul(coeff[k], (*iter[pos[0]])->coeff, tmp);
+	    mul(coeff[k], rc->c[pos[0]].coeff(iter[pos[0]]), tmp);
 	}
 	++iter[pos[0]];
 	for (int i = 1; i < len; ++i) {
 	    for (int k = 0; k < n; ++k) {
 		value2zz(num[k]->coeff->p[rc->len-1-pos[i]], tmp);
-		mul(tmp, (*iter[pos[i]])->coeff, tmp);
+		mul(tmp, rc->c[pos[i]].coeff(iter[pos[i]]), tmp);
 		add(coeff[k], coeff[k], tmp);
 	    }
 	    ++iter[pos[i]];
@@ -395,7 +405,8 @@ void reducer::handle(const mat_ZZ& den, Value *V, const QQ& c,
 
     Matrix *points = Matrix_Alloc(det, dim);
     Matrix* Rays = zz2matrix(den);
-    lattice_points_fixed(V, V, Rays, Rays, points, det);
+    lattice_points_fixed(V, V, Rays, Rays, points, det, closed,
+			 &points_cache);
     Matrix_Free(Rays);
     matrix2zz(points, vertex, points->NbRows, points->NbColumns);
     Matrix_Free(points);
@@ -10,6 +10,7 @@
 #include <barvinok/options.h>
 #include "decomposer.h"
 #include "dpoly.h"
+#include "lattice_point.h"
 
 using namespace NTL;
 
@@ -20,8 +21,12 @@ extern struct OrthogonalException {} Orthogonal;
 /* base for non-parametric counting */
 struct np_base : public signed_cone_consumer {
     unsigned dim;
+    /* closed flags of the cone currently being handled, if any */
+    const int *closed;
+    /* ray dependent data for lattice_points_fixed */
+    lattice_points_cache points_cache;
 
-    np_base(unsigned dim) {
+    np_base(unsigned dim) : closed(NULL) {
 	assert(dim > 0);
 	this->dim = dim;
     }
@@ -30,6 +35,7 @@ struct np_base : public signed_cone_consumer {
 			unsigned long det,
 			barvinok_options *options) = 0;
     virtual void handle(const signed_cone& sc, barvinok_options *options);
+    virtual bool handles_open_rays() { return true; }
     virtual void start(Polyhedron *P, barvinok_options *options);
     void do_vertex_cone(const QQ& factor, Polyhedron *Cone, 
 			Value *vertex, barvinok_options *options) {
@@ -1,10 +1,12 @@
 #include <assert.h>
+#include <vector>
 #include <NTL/vec_ZZ.h>
 #include <barvinok/polylib.h>
 #include <barvinok/barvinok.h>
 #include <barvinok/util.h>
 #include "genfun_constructor.h"
 #include "lattice_width.h"
+#include "parallel.h"
 #include "remove_equalities.h"
 
 using std::cerr;
@@ -200,10 +202,74 @@ static bool more_shifts_needed(int j, int n,
 static gen_fun *project(Polyhedron *P, unsigned n, barvinok_options *options,
 			int free_P);
 
+/* Compute the generating function of the part of P in the domain
+ * of each lattice width direction, with the corresponding direction
+ * projected out, and store the result in sum[i].
+ * The domains are disjoint and the directions can therefore
+ * be handled independently, each with its own generating functions.
+ */
+struct project_directions : public parallel_body {
+    Polyhedron *P;
+    unsigned n;
+    struct width_direction_array *dirs;
+    std::vector<gen_fun *> sum;
+
+    project_directions(Polyhedron *P, unsigned n,
+			struct width_direction_array *dirs) :
+		P(P), n(n), dirs(dirs), sum(dirs->n) {}
+    virtual void run(int i, barvinok_options *options);
+};
+
+void project_directions::run(int i, barvinok_options *options)
+{
+    QQ mone(-1, 1);
+    vec_ZZ up;
+    Polyhedron *Pi, *R;
+    Polyhedron *CA;
+    gen_fun *S, *S_shift, *S_divide;
+
+    up.SetLength(P->Dimension - (n-1));
+    up[0] = 1;
+    for (int k = 1; k < P->Dimension - (n-1); ++k)
+	up[k] = 0;
+
+    CA = align_context(dirs->wd[i].domain, P->Dimension, options->MaxRays);
+    R = DomainIntersection(P, CA, options->MaxRays);
+    Polyhedron_Free(CA);
+    assert(dirs->wd[i].dir->Size == n);
+    Pi = put_direction_last(R, dirs->wd[i].dir, options->MaxRays);
+    Polyhedron_Free(R);
+
+    S = project(Pi, n-1, options, 1);
+
+    S_shift = new gen_fun(S);
+    S_divide = new gen_fun(S);
+    S_divide->divide(up);
+
+    for (int j = 0; more_shifts_needed(j, n, S, S_divide, up, options); ++j) {
+	gen_fun *hp;
+
+	S_shift->shift(up);
+	hp = S->Hadamard_product(S_shift, options);
+	S->add(mone, hp, options);
+
+	delete hp;
+    }
+
+    sum[i] = S->summate(1, options);
+
+    delete S_shift;
+    delete S_divide;
+    delete S;
+}
+
 /* Return gf of P projected on last dim(P)-n coordinates, i.e.,
  * project out the first n coordinates.
  *
  * Assumes P has no equalities.
+ *
+ * The lattice width directions are handled in parallel
+ * and their contributions are added in the order of the directions.
  */
 static gen_fun *project_full_dim(Polyhedron *P, unsigned n,
 	barvinok_options *options)
@@ -218,14 +284,14 @@ static gen_fun *project_full_dim(Polyhedron *P, unsigned n,
     if (n == 0)
 	return barvinok_enumerate_series(P, P->Dimension, options);
 
-    up.SetLength(P->Dimension - (n-1));
-    up[0] = 1;
-    for (int i = 1; i < P->Dimension - (n-1); ++i)
-	up[i] = 0;
-
     if (n == 1) {
 	gen_fun *S, *S_shift, *hp;
 
+	up.SetLength(P->Dimension);
+	up[0] = 1;
+	for (int i = 1; i < P->Dimension; ++i)
+	    up[i] = 0;
+
 	S = barvinok_enumerate_series(P, P->Dimension, options);
 	S_shift = new gen_fun(S);
 	S_shift->shift(up);
@@ -244,45 +310,15 @@ static gen_fun *project_full_dim(Polyhedron *P, unsigned n,
     dirs = Polyhedron_Lattice_Width_Directions(P, U, options);
     Polyhedron_Free(U);
 
-    for (int i = 0; i < dirs->n; ++i) {
-	Polyhedron *Pi, *R;
-	Polyhedron *CA;
-	gen_fun *S, *S_shift, *S_divide, *sum;
-
-	CA = align_context(dirs->wd[i].domain, P->Dimension, options->MaxRays);
-	R = DomainIntersection(P, CA, options->MaxRays);
-	Polyhedron_Free(CA);
-	assert(dirs->wd[i].dir->Size == n);
-	Pi = put_direction_last(R, dirs->wd[i].dir, options->MaxRays);
-	Polyhedron_Free(R);
-
-	S = project(Pi, n-1, options, 1);
-
-	S_shift = new gen_fun(S);
-	S_divide = new gen_fun(S);
-	S_divide->divide(up);
-
-	for (int j = 0; more_shifts_needed(j, n, S, S_divide, up, options); ++j) {
-	    gen_fun *hp;
-
-	    S_shift->shift(up);
-	    hp = S->Hadamard_product(S_shift, options);
-	    S->add(mone, hp, options);
-
-	    delete hp;
-	}
-
-	sum = S->summate(1, options);
-
-	delete S_shift;
-	delete S_divide;
-	delete S;
+    project_directions directions(P, n, dirs);
+    parallel_for(dirs->n, directions, options);
 
+    for (int i = 0; i < dirs->n; ++i) {
 	if (!gf)
-	    gf = sum;
+	    gf = directions.sum[i];
 	else {
-	    gf->add(one, sum, options);
-	    delete sum;
+	    gf->add(one, directions.sum[i], options);
+	    delete directions.sum[i];
 	}
     }
     free_width_direction_array(dirs);
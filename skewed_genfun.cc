@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 #include "conversion.h"
 #include "skewed_genfun.h"
 
@@ -26,16 +27,16 @@ void skewed_gen_fun::print(std::ostream& os, unsigned int nparam,
     gf->print(os, nparam, param_name);
 }
 
-void skewed_gen_fun::coefficient(Value* params, Value* c,
-				 barvinok_options *options) const
+/* Are the equalities and divisibilities of the original space
+ * satisfied by params?
+ */
+bool skewed_gen_fun::valid(Value *params) const
 {
     if (eq) {
 	for (int i = 0; i < eq->NbRows; ++i) {
 	    Inner_Product(eq->p[i]+1, params, eq->NbColumns-2, eq->p[i]);
-	    if (value_notzero_p(eq->p[i][0])) {
-		value_set_si(*c, 0);
-		return;
-	    }
+	    if (value_notzero_p(eq->p[i][0]))
+		return false;
 	}
     }
     if (div) {
@@ -44,12 +45,22 @@ void skewed_gen_fun::coefficient(Value* params, Value* c,
 	for (int i = 0; i < div->NbRows; ++i) {
 	    Inner_Product(div->p[i], params, div->NbColumns-1, &tmp);
 	    if (!mpz_divisible_p(tmp, div->p[i][div->NbColumns-1])) {
-		value_set_si(*c, 0);
-		return;
+		value_clear(tmp);
+		return false;
 	    }
 	}
 	value_clear(tmp);
     }
+    return true;
+}
+
+void skewed_gen_fun::coefficient(Value* params, Value* c,
+				 barvinok_options *options) const
+{
+    if (!valid(params)) {
+	value_set_si(*c, 0);
+	return;
+    }
 
     ZZ coeff;
     if (!T)
@@ -65,3 +76,46 @@ void skewed_gen_fun::coefficient(Value* params, Value* c,
 
     zz2value(coeff, *c);
 }
+
+/* Compute the coefficients for all rows of points (in the original space)
+ * and store them in c, as in calling coefficient on each row.
+ * As in coefficient, each row is followed by a homogeneous coordinate 1.
+ */
+void skewed_gen_fun::coefficients(Matrix *points, Value *c,
+				  barvinok_options *options) const
+{
+    unsigned dim = T ? T->NbRows : points->NbColumns;
+
+    if (points->NbRows == 0)
+	return;
+
+    Matrix *p2 = Matrix_Alloc(points->NbRows, dim);
+    std::vector<int> pos(points->NbRows, -1);
+
+    p2->NbRows = 0;
+    for (int i = 0; i < points->NbRows; ++i) {
+	if (!valid(points->p[i]))
+	    continue;
+	pos[i] = p2->NbRows;
+	Value *p = p2->p[p2->NbRows++];
+	if (!T)
+	    Vector_Copy(points->p[i], p, dim);
+	else {
+	    Matrix_Vector_Product(T, points->p[i], p);
+	    if (value_notone_p(p[dim-1]))
+		Vector_AntiScale(p, p, p[dim-1], dim);
+	}
+    }
+
+    Vector *c2 = Vector_Alloc(p2->NbRows);
+    gf->coefficients(p2, c2->p, options);
+    for (int i = 0; i < points->NbRows; ++i)
+	if (pos[i] < 0)
+	    value_set_si(c[i], 0);
+	else
+	    value_assign(c[i], c2->p[pos[i]]);
+    Vector_Free(c2);
+
+    p2->NbRows = points->NbRows;
+    Matrix_Free(p2);
+}
@@ -38,6 +38,10 @@ struct skewed_gen_fun {
 	return *gf;
     }
     void coefficient(Value* params, Value* c, barvinok_options *options) const;
+    void coefficients(Matrix *points, Value *c,
+		      barvinok_options *options) const;
+private:
+    bool valid(Value *params) const;
 };
 
 #endif
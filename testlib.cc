@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sstream>
+#include <stdexcept>
 #include <NTL/vec_ZZ.h>
 #include <NTL/mat_ZZ.h>
 #include <barvinok/NTL_QQ.h>
@@ -14,15 +16,23 @@
 #include "conversion.h"
 #include "evalue_read.h"
 #include "dpoly.h"
+#include "enumerate_e_memo.h"
+#include "fixed_dim.h"
 #include "lattice_point.h"
 #include "counter.h"
 #include "bernoulli.h"
 #include "hilbert.h"
+#include "hilbert_zsolve.h"
 #include "hull.h"
 #include "ilp.h"
 #include "laurent.h"
 #include "matrix_read.h"
+#include "param_util.h"
+#include "parallel.h"
 #include "remove_equalities.h"
+#include "skewed_genfun.h"
+#include "topcom.h"
+#include "volume.h"
 #include "config.h"
 
 using std::cout;
@@ -250,6 +260,105 @@ int test_specialization(struct barvinok_options *options)
     return 0;
 }
 
+/* Compare the sums of the (falling) powers computed by add_power_sums
+ * with those computed directly using GMP.
+ * The values are chosen such that some of them and some of their powers
+ * fit in 64 bits, while others do not, and such that they span
+ * several blocks of values.
+ */
+static int test_power_sums(struct barvinok_options *options)
+{
+    const char *values[] = { "0", "1", "-1", "2", "7", "-13", "100000",
+	"-3037000499", "3037000500", "4611686018427387903",
+	"-4611686018427387904", "4611686018427387904",
+	"-123456789012345678901234567890" };
+    int n_values = sizeof(values)/sizeof(*values);
+    int n = 3 * n_values;
+    int degree = 5;
+    Vector *v = Vector_Alloc(n);
+    Vector *sum = Vector_Alloc(degree + 1);
+    Value tmp;
+
+    value_init(tmp);
+    for (int falling = 0; falling <= 1; ++falling) {
+	dpoly d(degree);
+
+	for (int k = 0; k < n; ++k) {
+	    mpz_set_str(v->p[k], values[k % n_values], 10);
+	    value_add_int(v->p[k], v->p[k], k / n_values);
+	}
+	Vector_Set(sum->p, 0, degree + 1);
+	for (int k = 0; k < n; ++k)
+	    for (int i = 0; i <= degree; ++i) {
+		if (falling)
+		    mpz_bin_ui(tmp, v->p[k], i);
+		else
+		    mpz_pow_ui(tmp, v->p[k], i);
+		value_addto(sum->p[i], sum->p[i], tmp);
+	    }
+
+	add_power_sums(d, v->p, n, falling);
+	assert(Vector_Equal(d.coeff->p, sum->p, degree + 1));
+    }
+    value_clear(tmp);
+    Vector_Free(sum);
+    Vector_Free(v);
+
+    return 0;
+}
+
+/* Check that merging a list of terms into another one, as done by
+ * dpoly_r_term_list::add, produces the same list as adding
+ * the (shifted and scaled) terms one by one.
+ */
+static int test_dpoly_r_merge(struct barvinok_options *options)
+{
+    const int dim = 3;
+    int powers[dim];
+    ZZ f, d, coeff;
+
+    for (int t = 0; t < 50; ++t) {
+	dpoly_r_term_list dst, src, ref;
+	int pos = t % (dim + 1) - 1;
+
+	dst.dim = src.dim = ref.dim = dim;
+	for (int i = 0; i < 8; ++i) {
+	    for (int k = 0; k < dim; ++k)
+		powers[k] = RandomBnd(3);
+	    conv(coeff, RandomBnd(7) - 3);
+	    dst.add(powers, coeff);
+	    ref.add(powers, coeff);
+	    for (int k = 0; k < dim; ++k)
+		powers[k] = RandomBnd(3);
+	    conv(coeff, RandomBnd(7) - 3);
+	    src.add(powers, coeff);
+	}
+	conv(f, RandomBnd(5) - 2);
+	conv(d, 1 + RandomBnd(2));
+
+	dst.add(src, pos, f, d);
+	for (int j = 0; j < src.size(); ++j) {
+	    for (int k = 0; k < dim; ++k)
+		powers[k] = src.powers(j)[k];
+	    if (pos >= 0)
+		powers[pos]++;
+	    mul(coeff, src.coeff(j), f);
+	    if (!IsOne(d))
+		coeff /= d;
+	    ref.add(powers, coeff);
+	}
+
+	assert(dst.size() == ref.size());
+	for (int j = 0; j < ref.size(); ++j) {
+	    assert(dpoly_r_term_list::cmp(dst.powers(j), ref.powers(j),
+					  dim) == 0);
+	    assert(dst.coeff(j) == ref.coeff(j));
+	}
+    }
+
+    return 0;
+}
+
 int test_lattice_points(struct barvinok_options *options)
 {
     Param_Vertices V;
@@ -325,10 +434,11 @@ static int test_infinite_counter(struct barvinok_options *options)
     set_from_string(n_power, "[[0][5][7]]");
     set_from_string(d_power, "[[1]]");
     cnt->reduce(n_coeff, n_power, d_power);
-    assert(value_cmp_si(mpq_numref(cnt->count[0]), 6) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[0]), 1) == 0);
-    assert(value_cmp_si(mpq_numref(cnt->count[1]), 0) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[1]), 1) == 0);
+    cnt->canonicalize();
+    assert(value_cmp_si(mpq_numref(cnt->count[0].q), 6) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[0].q), 1) == 0);
+    assert(value_cmp_si(mpq_numref(cnt->count[1].q), 0) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[1].q), 1) == 0);
     delete cnt;
     Polyhedron_Free(ctx);
 
@@ -343,11 +453,12 @@ static int test_infinite_counter(struct barvinok_options *options)
     set_from_string(n_power, "[[0 0][1 1]]");
     set_from_string(d_power, "[[1 0][1 1]]");
     cnt->reduce(n_coeff, n_power, d_power);
-    assert(value_cmp_si(mpq_numref(cnt->count[1]), 0) != 0);
-    assert(value_cmp_si(mpq_numref(cnt->count[2]), 0) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[2]), 1) == 0);
-    assert(value_cmp_si(mpq_numref(cnt->count[3]), 0) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[3]), 1) == 0);
+    cnt->canonicalize();
+    assert(value_cmp_si(mpq_numref(cnt->count[1].q), 0) != 0);
+    assert(value_cmp_si(mpq_numref(cnt->count[2].q), 0) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[2].q), 1) == 0);
+    assert(value_cmp_si(mpq_numref(cnt->count[3].q), 0) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[3].q), 1) == 0);
     delete cnt;
 
     cnt = new infinite_counter(2, 2);
@@ -356,12 +467,13 @@ static int test_infinite_counter(struct barvinok_options *options)
     set_from_string(n_power, "[[2 6][3 6]]");
     d_power.SetDims(0, 2);
     cnt->reduce(n_coeff, n_power, d_power);
-    assert(value_cmp_si(mpq_numref(cnt->count[0]), 1) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[0]), 6) == 0);
-    assert(value_cmp_si(mpq_numref(cnt->count[1]), 0) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[1]), 1) == 0);
-    assert(value_cmp_si(mpq_numref(cnt->count[2]), 0) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[2]), 1) == 0);
+    cnt->canonicalize();
+    assert(value_cmp_si(mpq_numref(cnt->count[0].q), 1) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[0].q), 6) == 0);
+    assert(value_cmp_si(mpq_numref(cnt->count[1].q), 0) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[1].q), 1) == 0);
+    assert(value_cmp_si(mpq_numref(cnt->count[2].q), 0) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[2].q), 1) == 0);
     delete cnt;
 
     cnt = new infinite_counter(2, 2);
@@ -370,9 +482,10 @@ static int test_infinite_counter(struct barvinok_options *options)
     set_from_string(n_power, "[[0 11]]");
     set_from_string(d_power, "[[0 1]]");
     cnt->reduce(n_coeff, n_power, d_power);
-    assert(value_cmp_si(mpq_numref(cnt->count[1]), 0) != 0);
-    assert(value_cmp_si(mpq_numref(cnt->count[2]), 0) == 0);
-    assert(value_cmp_si(mpq_denref(cnt->count[2]), 1) == 0);
+    cnt->canonicalize();
+    assert(value_cmp_si(mpq_numref(cnt->count[1].q), 0) != 0);
+    assert(value_cmp_si(mpq_numref(cnt->count[2].q), 0) == 0);
+    assert(value_cmp_si(mpq_denref(cnt->count[2].q), 1) == 0);
     delete cnt;
 
     Polyhedron_Free(ctx);
@@ -403,6 +516,82 @@ static int test_series(struct barvinok_options *options)
     return 0;
 }
 
+/* Check that the coefficients computed in a single batch are
+ * the same as those computed one point at a time, both for
+ * a plain generating function and for one that is only valid
+ * on a (transformed) sublattice of the parameter space.
+ */
+static int test_coefficients(struct barvinok_options *options)
+{
+    Matrix *M, *T, *div, *points;
+    Polyhedron *P, *C;
+    gen_fun *gf;
+    Vector *c;
+    Value v;
+    int expected[] = { 4, 4, 5, 0, 1 };
+    int skewed_expected[] = { 4, 0, 5, 0, 4 };
+
+    value_init(v);
+
+    M = matrix_read_from_str(
+	"3 5\n"
+	"1  1 0 0 0\n"
+	"1 -1 1 0 0\n"
+	"1 -1 0 1 0\n");
+    P = Constraints2Polyhedron(M, options->MaxRays);
+    Matrix_Free(M);
+    C = Universe_Polyhedron(2);
+    gf = barvinok_series_with_options(P, C, options);
+    Polyhedron_Free(P);
+    Polyhedron_Free(C);
+
+    points = matrix_read_from_str(
+	"5 3\n"
+	" 3 5 1\n"
+	" 5 3 1\n"
+	" 4 4 1\n"
+	"-1 2 1\n"
+	" 0 0 1\n");
+    c = Vector_Alloc(points->NbRows);
+    gf->coefficients(points, c->p, options);
+    for (int i = 0; i < points->NbRows; ++i) {
+	zz2value(gf->coefficient(points->p[i], options), v);
+	assert(value_eq(c->p[i], v));
+	assert(value_cmp_si(v, expected[i]) == 0);
+    }
+
+    /* (a, b) -> (a/2, b), valid only for even a */
+    T = matrix_read_from_str(
+	"3 3\n"
+	"1 0 0\n"
+	"0 2 0\n"
+	"0 0 2\n");
+    div = matrix_read_from_str(
+	"1 4\n"
+	"1 0 0 2\n");
+    skewed_gen_fun sgf(gf, T, NULL, div);
+    Matrix_Free(points);
+    points = matrix_read_from_str(
+	"5 3\n"
+	" 6 5 1\n"
+	" 7 5 1\n"
+	" 8 4 1\n"
+	"-2 2 1\n"
+	"10 3 1\n");
+    sgf.coefficients(points, c->p, options);
+    for (int i = 0; i < points->NbRows; ++i) {
+	sgf.coefficient(points->p[i], &v, options);
+	assert(value_eq(c->p[i], v));
+	assert(value_cmp_si(v, skewed_expected[i]) == 0);
+    }
+
+    Vector_Free(c);
+    Matrix_Free(points);
+    value_clear(v);
+
+    return 0;
+}
+
 int test_todd(struct barvinok_options *options)
 {
     tcounter t(2, options->max_index);
@@ -428,24 +617,27 @@ int test_todd(struct barvinok_options *options)
     zz2values(v, vertex->p);
 
     t.handle(rays, vertex->p, one, 1, options);
-    assert(value_cmp_si(mpq_numref(t.count), 71) == 0);
-    assert(value_cmp_si(mpq_denref(t.count), 24) == 0);
+    t.count.canonicalize();
+    assert(value_cmp_si(mpq_numref(t.count.q), 71) == 0);
+    assert(value_cmp_si(mpq_denref(t.count.q), 24) == 0);
 
     set_from_string(rays, "[[0 -1][1 -1]]");
     set_from_string(v, "[0 2 1]");
     zz2values(v, vertex->p);
 
     t.handle(rays, vertex->p, one, 1, options);
-    assert(value_cmp_si(mpq_numref(t.count), 71) == 0);
-    assert(value_cmp_si(mpq_denref(t.count), 12) == 0);
+    t.count.canonicalize();
+    assert(value_cmp_si(mpq_numref(t.count.q), 71) == 0);
+    assert(value_cmp_si(mpq_denref(t.count.q), 12) == 0);
 
     set_from_string(rays, "[[1 0][0 1]]");
     set_from_string(v, "[0 0 1]");
     zz2values(v, vertex->p);
 
     t.handle(rays, vertex->p, one, 1, options);
-    assert(value_cmp_si(mpq_numref(t.count), 6) == 0);
-    assert(value_cmp_si(mpq_denref(t.count), 1) == 0);
+    t.count.canonicalize();
+    assert(value_cmp_si(mpq_numref(t.count.q), 6) == 0);
+    assert(value_cmp_si(mpq_denref(t.count.q), 1) == 0);
 
     Vector_Free(vertex);
     return 0;
@@ -587,7 +779,7 @@ int test_hilbert(struct barvinok_options *options)
     Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
     Matrix_Free(M);
 
-    M = Cone_Hilbert_Basis(P, options->MaxRays);
+    M = Cone_Hilbert_Basis(P, options);
     assert(M->NbRows == 5);
     assert(M->NbColumns == 3);
     Matrix_Free(M);
@@ -598,6 +790,34 @@ int test_hilbert(struct barvinok_options *options)
     Matrix_Free(M);
 
     Polyhedron_Free(P);
+
+    /* x + 3000000000 y - 3000000000 z = 0 does not fit in 32 bits,
+     * but its Hilbert basis { (0,1,1), (3000000000,0,1) }
+     * can be computed on 64-bit integers.
+     */
+    M = matrix_read_from_str(
+	"1 5\n"
+	"   0    1    3000000000   -3000000000    0 \n");
+    Matrix *H = zsolve_hilbert_basis32(M, 3, options);
+    assert(!H);
+    H = zsolve_hilbert_basis64(M, 3, options);
+    Matrix_Free(M);
+    assert(H);
+    assert(H->NbRows == 2);
+    assert(H->NbColumns == 4);
+    M = matrix_read_from_str(
+	"2 4\n"
+	"   0             1    1    1 \n"
+	"   3000000000    0    1    1 \n");
+    for (int i = 0; i < M->NbRows; ++i) {
+	int j;
+	for (j = 0; j < H->NbRows; ++j)
+	    if (Vector_Equal(M->p[i], H->p[j], M->NbColumns))
+		break;
+	assert(j < H->NbRows);
+    }
+    Matrix_Free(M);
+    Matrix_Free(H);
 #endif
     return 0;
 }
@@ -684,6 +904,163 @@ int test_hull(struct barvinok_options *options)
     return 0;
 }
 
+/* Count the points in a triangle while no additional threads
+ * are available, such that the decomposition cannot be moved to
+ * a separate thread, and while the file for saving the cones
+ * cannot be opened.  In both cases, the cones should simply be
+ * decomposed in the calling thread.
+ */
+static int test_cone_stream_fallback(struct barvinok_options *options)
+{
+    /* 0 <= x, 0 <= y, x + y <= 5 */
+    Matrix *M = matrix_read_from_str(
+	"3 4\n"
+	"   1  1  0  0\n"
+	"   1  0  1  0\n"
+	"   1 -1 -1  5\n");
+    Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
+    Matrix_Free(M);
+    unsigned long threads = options->threads;
+    unsigned long reserved;
+    Value c;
+
+    value_init(c);
+
+    options->threads = 2;
+    reserved = parallel_reserve_threads(1, options);
+    barvinok_count_with_options(P, &c, options);
+    assert(value_cmp_si(c, 21) == 0);
+    parallel_release_threads(reserved);
+    options->threads = threads;
+
+    options->save_cones = strdup("/nonexistent/cones");
+    barvinok_count_with_options(P, &c, options);
+    assert(value_cmp_si(c, 21) == 0);
+    assert(!options->save_cones);
+    assert(!options->cone_file);
+
+    value_clear(c);
+    Polyhedron_Free(P);
+
+    return 0;
+}
+
+/* Check that the chamber walk handles equalities in the polytope.
+ * { (x, y) | x + y = n, x, y >= 0 } has two vertices, (0, n) and (n, 0),
+ * which are both active in the single chamber n >= 0.
+ */
+static int test_topcom_equalities(struct barvinok_options *options)
+{
+    Matrix *M = matrix_read_from_str(
+	"3 5\n"
+	"   0  1  1 -1  0\n"
+	"   1  1  0  0  0\n"
+	"   1  0  1  0  0\n");
+    Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
+    Matrix_Free(M);
+    M = matrix_read_from_str(
+	"1 3\n"
+	"   1  1  0\n");
+    Polyhedron *C = Constraints2Polyhedron(M, options->MaxRays);
+    Matrix_Free(M);
+    assert(P->NbEq == 1);
+
+    Param_Polyhedron *PP = TC_P2PP(P, C, options);
+    assert(PP->nbV == 2);
+    assert(PP->D && !PP->D->next);
+    assert(bit_vector_count(PP->D->F, 1) == 2);
+    Param_Polyhedron_Free(PP);
+
+    Polyhedron_Free(C);
+    Polyhedron_Free(P);
+
+    return 0;
+}
+
+static int test_enumerate_at_points(struct barvinok_options *options)
+{
+    /* 0 <= x <= n, x <= m */
+    Matrix *M = matrix_read_from_str(
+	"3 5\n"
+	"   1  1  0  0  0\n"
+	"   1 -1  1  0  0\n"
+	"   1 -1  0  1  0\n");
+    Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
+    Matrix_Free(M);
+    Polyhedron *C = Universe_Polyhedron(2);
+    /* (4,4) lies on the boundary between the chambers n <= m and m <= n
+     * and (0,7) on the boundary of the parameter domain.
+     */
+    Matrix *points = matrix_read_from_str(
+	"4 2\n"
+	"   3 5\n"
+	"   5 3\n"
+	"   4 4\n"
+	"   0 7\n");
+    int expected[] = { 4, 4, 5, 1 };
+
+    evalue *full = barvinok_enumerate_with_options(P, C, options);
+    evalue *partial = barvinok_enumerate_at_points(P, C, points, options);
+    for (int i = 0; i < points->NbRows; ++i) {
+	evalue *f = evalue_eval(full, points->p[i]);
+	evalue *p = evalue_eval(partial, points->p[i]);
+	assert(eequal(f, p));
+	assert(value_one_p(f->d));
+	assert(value_cmp_si(f->x.n, expected[i]) == 0);
+	evalue_free(f);
+	evalue_free(p);
+    }
+    evalue_free(full);
+    evalue_free(partial);
+
+    Matrix_Free(points);
+    Polyhedron_Free(C);
+    Polyhedron_Free(P);
+
+    return 0;
+}
+
+/* Enumerate the same problem twice while sharing the memoization table,
+ * such that the second enumeration is answered from the table,
+ * and check that the results are identical to the one obtained
+ * without memoization.
+ */
+static int test_enumerate_e_memo(struct barvinok_options *options)
+{
+    /* { x | exists y: x = 2y and 0 <= x <= n } */
+    Matrix *M = matrix_read_from_str(
+	"3 5\n"
+	"   0  1 -2  0  0\n"
+	"   1  1  0  0  0\n"
+	"   1 -1  0  1  0\n");
+    Polyhedron *P = Constraints2Polyhedron(M, options->MaxRays);
+    Matrix_Free(M);
+    unsigned long memo = options->enumerate_e_memo;
+
+    options->enumerate_e_memo = 0;
+    evalue *E = barvinok_enumerate_e_with_options(P, 1, 1, options);
+
+    options->enumerate_e_memo = 1024;
+    {
+	enumerate_e_memo_scope scope(options);
+	evalue *E1 = barvinok_enumerate_e_with_options(P, 1, 1, options);
+	long hits = options->stats->enumerate_e_memo_hits;
+	evalue *E2 = barvinok_enumerate_e_with_options(P, 1, 1, options);
+	assert(options->stats->enumerate_e_memo_hits == hits + 1);
+	assert(eequal(E, E1));
+	assert(eequal(E, E2));
+	evalue_free(E1);
+	evalue_free(E2);
+    }
+    assert(!options->enumerate_e_memo_table);
+    options->enumerate_e_memo = memo;
+
+    evalue_free(E);
+    Polyhedron_Free(P);
+
+    return 0;
+}
+
 static int test_laurent(struct barvinok_options *options)
 {
     unsigned nvar, nparam;
@@ -750,6 +1127,135 @@ static int test_basis_reduction(struct barvinok_options *options)
     return 0;
 }
 
+/* Compare the fixed dimension kernels to the NTL routines on random
+ * matrices with entries of different sizes, such that some of them
+ * are handled by the kernels and others fall back to NTL.
+ * Some of the matrices have a zero in the top left corner or
+ * two equal rows to exercise pivoting and singular matrices.
+ */
+static int test_fixed_dim(struct barvinok_options *options)
+{
+    long bounds[] = { 3, 1L << 10, 1L << 40 };
+
+    for (int n = 1; n <= FIXED_DIM_MAX + 1; ++n)
+	for (int b = 0; b < sizeof(bounds)/sizeof(*bounds); ++b)
+	    for (int t = 0; t < 10; ++t) {
+		mat_ZZ A, X1, X2;
+		ZZ d1, d2;
+
+		A.SetDims(n, n);
+		for (int i = 0; i < n; ++i)
+		    for (int j = 0; j < n; ++j)
+			conv(A[i][j],
+			     RandomBnd(2 * bounds[b] + 1) - bounds[b]);
+		if (t % 3 == 1)
+		    clear(A[0][0]);
+		if (t % 3 == 2 && n > 1)
+		    A[n-1] = A[0];
+
+		determinant_fixed(d1, A);
+		determinant(d2, A);
+		assert(d1 == d2);
+
+		inv_fixed(d1, X1, A);
+		inv(d2, X2, A);
+		assert(d1 == d2);
+		if (!IsZero(d2))
+		    assert(X1 == X2);
+	    }
+
+    return 0;
+}
+
+/* Compare the determinants of parametric matrices computed using
+ * Berkowitz's algorithm to those computed using Laplace's formula.
+ * Both an odd and an even dimension above the size up to which
+ * Laplace's formula is used are tested since the sign of the result
+ * of Berkowitz's algorithm depends on the parity of the dimension.
+ * The determinants are compared at a few values of the parameters
+ * and, at the origin, to the known value.
+ */
+static int test_determinant(struct barvinok_options *options)
+{
+    const int nparam = 2;
+    int points[][nparam] = { { 0, 0 }, { 1, -2 }, { 3, 5 }, { -4, 2 } };
+    int at_origin[] = { 1029, -7203 };
+    Vector *coeff = Vector_Alloc(nparam + 1);
+    Vector *point = Vector_Alloc(nparam);
+    Value one;
+
+    value_init(one);
+    value_set_si(one, 1);
+    for (int dim = 5; dim <= 6; ++dim) {
+	evalue ***matrix = new evalue **[dim];
+	for (int i = 0; i < dim; ++i) {
+	    matrix[i] = new evalue *[dim];
+	    for (int j = 0; j < dim; ++j) {
+		for (int k = 0; k < nparam + 1; ++k)
+		    value_set_si(coeff->p[k],
+				 ((i+1) * (j+2) * (k+3) + i * i + j) % 7 - 3);
+		matrix[i][j] = affine2evalue(coeff->p, one, nparam);
+	    }
+	}
+
+	evalue *laplace = determinant_laplace(matrix, dim);
+	evalue *berkowitz = determinant_berkowitz(matrix, dim);
+	for (int p = 0; p < sizeof(points)/sizeof(*points); ++p) {
+	    for (int k = 0; k < nparam; ++k)
+		value_set_si(point->p[k], points[p][k]);
+	    evalue *l = evalue_eval(laplace, point->p);
+	    evalue *b = evalue_eval(berkowitz, point->p);
+	    assert(eequal(l, b));
+	    if (p == 0)
+		assert(value_cmp_si(b->x.n, at_origin[dim - 5]) == 0);
+	    evalue_free(l);
+	    evalue_free(b);
+	}
+	evalue_free(laplace);
+	evalue_free(berkowitz);
+
+	for (int i = 0; i < dim; ++i) {
+	    for (int j = 0; j < dim; ++j)
+		evalue_free(matrix[i][j]);
+	    delete [] matrix[i];
+	}
+	delete [] matrix;
+    }
+    value_clear(one);
+    Vector_Free(point);
+    Vector_Free(coeff);
+
+    return 0;
+}
+
+struct throwing_body : public parallel_body {
+    virtual void run(int i, barvinok_options *options) {
+	if (i == 5)
+	    throw std::runtime_error("iteration 5");
+    }
+};
+
+/* Check that an exception thrown by an iteration of parallel_for
+ * reaches the caller with its original type.
+ */
+static int test_parallel_exception(struct barvinok_options *options)
+{
+    unsigned long threads = options->threads;
+    throwing_body body;
+    int caught = 0;
+
+    options->threads = 4;
+    try {
+	parallel_for(10, body, options);
+    } catch (std::runtime_error &e) {
+	caught = 1;
+    }
+    assert(caught);
+    options->threads = threads;
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     struct barvinok_options *options = barvinok_options_new_with_defaults();
@@ -759,18 +1265,29 @@ int main(int argc, char **argv)
     test_evalue(options);
     test_substitute(options);
     test_specialization(options);
+    test_power_sums(options);
+    test_dpoly_r_merge(options);
     test_lattice_points(options);
     test_icounter(options);
     test_infinite_counter(options);
     test_series(options);
+    test_coefficients(options);
     test_todd(options);
     test_bernoulli(options);
     test_bernoulli_sum(options);
     test_hilbert(options);
     test_ilp(options);
     test_hull(options);
+    test_cone_stream_fallback(options);
+    test_topcom_equalities(options);
+    test_enumerate_at_points(options);
+    test_enumerate_e_memo(options);
     test_laurent(options);
     test_basis_reduction(options);
+    test_fixed_dim(options);
+    test_determinant(options);
+    test_parallel_exception(options);
+    bernoulli_free_caches();
     barvinok_options_free(options);
 
     return EXIT_SUCCESS;
@@ -1,62 +1,48 @@
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <barvinok/util.h>
 #include <barvinok/options.h>
-#include <unistd.h>
-#include "normalization.h"
+#include "reduce_domain.h"
 #include "topcom.h"
 #include "config.h"
 
 #define ALLOC(type) (type*)malloc(sizeof(type))
 
-void run_points2triangs(pid_t *child, int *in, int *out)
-{
-    int in_fd[2], out_fd[2];
-
-    if (pipe(in_fd))
-	assert(0);
-    if (pipe(out_fd))
-	assert(0);
-    *child = fork();
-    assert(*child >= 0);
-    if (!*child) {
-	int rc;
-
-	dup2(in_fd[0], 0);
-	dup2(out_fd[1], 1);
-	close(in_fd[0]);
-	close(out_fd[1]);
-	close(in_fd[1]);
-	close(out_fd[0]);
-
-	rc = execl(POINTS2TRIANGS_PATH, "points2triangs", "--regular", NULL);
-	assert(0);
-    }
-    close(in_fd[0]);
-    close(out_fd[1]);
-    *in = in_fd[1];
-    *out = out_fd[0];
-}
+/* The chamber decomposition below used to be computed by running
+ * TOPCOM's points2triangs on the Gale dual of the constraints
+ * and reading back the regular triangulations, each of which
+ * corresponds to a chamber and each simplex of which
+ * corresponds to a vertex that is active in the chamber.
+ * The same information is now computed in-process by walking
+ * the chamber complex.  Given a generic point of a chamber,
+ * the active vertices are obtained by computing the vertices
+ * of the polytope at that point and the chamber itself is
+ * the intersection of the activity domains of those vertices.
+ * The neighboring chambers are found by stepping across each
+ * of the facets of the chamber.
+ */
 
 struct domain {
     Param_Domain    domain;
     int		    F_len;
 };
 
-static Param_Vertices *construct_vertex(unsigned *vertex_facets,
-				       Matrix *Constraints,
-				       int d, unsigned nparam, unsigned MaxRays)
+/* Compute the parametric vertex determined by the nvar constraints
+ * in vertex_facets, or return NULL if these constraints
+ * are not linearly independent.
+ */
+static Matrix *basis_vertex(unsigned *vertex_facets, Matrix *Constraints,
+			    int d, unsigned nparam)
 {
     unsigned nvar = Constraints->NbColumns-2 - nparam;
     Matrix *A = Matrix_Alloc(nvar+1, nvar+1);
     Matrix *inv = Matrix_Alloc(nvar+1, nvar+1);
     Matrix *B = Matrix_Alloc(nvar, nparam+2);
-    Matrix *V = Matrix_Alloc(nvar, nparam+2);
-    Matrix *Domain = Matrix_Alloc(d-nvar, nparam+2);
-    Polyhedron *AD;
+    Matrix *V;
     unsigned bx;
     int i, j, ix;
     int ok;
-    Param_Vertices *vertex;
 
     for (j = 0, i = 0, ix = 0, bx = MSB; i < d; ++i) {
 	if ((vertex_facets[ix] & bx) == bx) {
@@ -68,8 +54,13 @@ static Param_Vertices *construct_vertex(unsigned *vertex_facets,
     assert(j == nvar);
     value_set_si(A->p[nvar][nvar], 1);
     ok = Matrix_Inverse(A, inv);
-    assert(ok);
     Matrix_Free(A);
+    if (!ok) {
+	Matrix_Free(inv);
+	Matrix_Free(B);
+	return NULL;
+    }
+    V = Matrix_Alloc(nvar, nparam+2);
     inv->NbRows = nvar;
     inv->NbColumns = nvar;
     Matrix_Product(inv, B, V);
@@ -79,6 +70,24 @@ static Param_Vertices *construct_vertex(unsigned *vertex_facets,
 	Vector_Normalize(V->p[i], V->NbColumns);
     }
     Matrix_Free(inv);
+    return V;
+}
+
+static Param_Vertices *construct_vertex(unsigned *vertex_facets,
+				       Matrix *Constraints,
+				       int d, unsigned nparam, unsigned MaxRays)
+{
+    unsigned nvar = Constraints->NbColumns-2 - nparam;
+    Matrix *V;
+    Matrix *A;
+    Matrix *Domain = Matrix_Alloc(d-nvar, nparam+2);
+    Polyhedron *AD;
+    unsigned bx;
+    int i, j, ix;
+    Param_Vertices *vertex;
+
+    V = basis_vertex(vertex_facets, Constraints, d, nparam);
+    assert(V);
     for (j = 0, i = 0, ix = 0, bx = MSB; i < d; ++i) {
 	if ((vertex_facets[ix] & bx) == bx) {
 	    NEXT(ix, bx);
@@ -251,163 +260,483 @@ static void remove_empty_chambers(Param_Domain **PD, unsigned vertex_words)
     }
 }
 
-static Param_Polyhedron *points2triangs(Matrix *K, Polyhedron *P, Polyhedron *C,
-					struct barvinok_options *options)
+/* A point q + e_1 dir[0] + e_2 dir[1] + ..., with e_1 >> e_2 >> ... > 0
+ * infinitesimally small.  The rows of dir include a basis
+ * of the parameter space, so that the point does not lie on any
+ * hyperplane that does not contain the whole parameter space.
+ * As in the result of inner_point, the coordinates of q start
+ * at position 1 and are followed by a positive denominator.
+ */
+struct perturbed_point {
+    Vector	*q;
+    Matrix	*dir;
+};
+
+/* Return the sign of the affine function g (coefficients of
+ * the parameters followed by the constant term) at pp.
+ */
+static int perturbed_sign(Value *g, struct perturbed_point *pp, Value *tmp)
 {
-    int in, out;
-    int i, j;
-    pid_t child;
-    FILE *fin, *fout;
-    int d = K->NbRows;
-    int words = (d+INT_BITS-1)/INT_BITS;
-    Param_Vertices *vertices = NULL;
-    struct domain *domains = NULL;
-    int vertex_words = 1;
-    Param_Polyhedron *PP = ALLOC(Param_Polyhedron);
-    unsigned MaxRays = options->MaxRays;
+    unsigned nparam = pp->q->Size-2;
+    int i;
 
-    PP->Rays = NULL;
-    PP->nbV = 0;
-    PP->Constraints = Polyhedron2Constraints(P);
-    /* We need the exact facets, because we may make some of them open later */
-    POL_UNSET(options->MaxRays, POL_INTEGER);
+    Inner_Product(g, pp->q->p+1, nparam+1, tmp);
+    if (value_notzero_p(*tmp))
+	return value_sign(*tmp);
+    for (i = 0; i < pp->dir->NbRows; ++i) {
+	Inner_Product(g, pp->dir->p[i], nparam, tmp);
+	if (value_notzero_p(*tmp))
+	    return value_sign(*tmp);
+    }
+    return 0;
+}
+
+static int perturbed_in_domain(Polyhedron *C, struct perturbed_point *pp)
+{
+    Value tmp;
+    int i;
+    int in = 1;
+
+    value_init(tmp);
+    for (i = 0; in && i < C->NbConstraints; ++i) {
+	int sign = perturbed_sign(C->Constraint[i]+1, pp, &tmp);
+	if (value_zero_p(C->Constraint[i][0]) ? sign != 0 : sign < 0)
+	    in = 0;
+    }
+    value_clear(tmp);
+    return in;
+}
 
-    run_points2triangs(&child, &in, &out);
+struct chamber_walk {
+    Polyhedron		*C;
+    Matrix		*Constraints;
+    unsigned		 nparam;
+    int			 d;
+    int			 neq;
+    int			 words;
+    int			 vertex_words;
+    Param_Polyhedron	*PP;
+    Param_Vertices	*vertices;
+    struct domain	*domains;
+    struct domain	**queue;
+    int			 n_queue;
+    int			 size_queue;
+    struct barvinok_options *options;
+};
+
+/* Is the basis of constraints in F, all of which belong to "tight",
+ * a vertex at the generic point pp?
+ * That is, is the vertex determined by the basis (lexicographically)
+ * feasible for the other tight constraints?
+ * The other constraints are not tight at the (non-perturbed) point
+ * and are therefore satisfied by the vertex.
+ */
+static int feasible_basis(struct chamber_walk *cw, unsigned *F,
+			  int *tight, int n_tight, struct perturbed_point *pp)
+{
+    Matrix *V;
+    Vector *row;
+    Value tmp;
+    int i;
+    int feasible = 1;
+
+    V = basis_vertex(F, cw->Constraints, cw->d, cw->nparam);
+    if (!V)
+	return 0;
+    row = Vector_Alloc(cw->nparam+2);
+    value_init(tmp);
+    for (i = 0; feasible && i < n_tight; ++i) {
+	int t = tight[i];
+	if (F[t / INT_BITS] & (MSB >> (t % INT_BITS)))
+	    continue;
+	Param_Inner_Product(cw->Constraints->p[t], V, row->p);
+	if (perturbed_sign(row->p+1, pp, &tmp) < 0)
+	    feasible = 0;
+    }
+    value_clear(tmp);
+    Vector_Free(row);
+    Matrix_Free(V);
+    return feasible;
+}
 
-    fin = fdopen(in, "w");
-    fprintf(fin, "[\n");
-    for (i = 0; i < K->NbRows; ++i) {
-	fprintf(fin, "[");
-	for (j = 0; j < K->NbColumns; ++j)
-	    value_print(fin, P_VALUE_FMT, K->p[i][j]);
-	fprintf(fin, "]");
+/* Add the vertices that are active at the generic point pp to "domain".
+ * The vertices of the polytope at the non-perturbed point are
+ * computed first.  The active vertices at the perturbed point
+ * are then those determined by a feasible basis among the constraints
+ * that are tight at any of these vertices.
+ * The equalities are tight everywhere and therefore belong to every basis,
+ * which is completed by nvar - neq of the tight inequalities.
+ */
+static void add_active_vertices(struct chamber_walk *cw, struct domain *domain,
+				struct perturbed_point *pp)
+{
+    unsigned nvar = cw->Constraints->NbColumns-2 - cw->nparam;
+    Matrix *M = Matrix_Alloc(cw->d, nvar+2);
+    Matrix *T;
+    Polyhedron *Q;
+    int *tight = malloc(cw->d * sizeof(int));
+    int *pos = malloc((nvar+1) * sizeof(int));
+    int nfree = nvar - cw->neq;
+    Value tmp;
+    int i, r;
+
+    value_init(tmp);
+    for (i = 0; i < cw->d; ++i) {
+	value_assign(M->p[i][0], cw->Constraints->p[i][0]);
+	Vector_Scale(cw->Constraints->p[i]+1, M->p[i]+1,
+		     pp->q->p[1+cw->nparam], nvar);
+	Inner_Product(cw->Constraints->p[i]+1+nvar, pp->q->p+1, cw->nparam+1,
+		      &M->p[i][1+nvar]);
     }
-    fprintf(fin, "]\n");
-    fclose(fin);
-
-    fout = fdopen(out, "r");
-    while (fscanf(fout, "T[%d]:=", &i) == 1) {
-	int a, b, c;
-	struct domain *domain = ALLOC(struct domain);
-	memset(domain, 0, sizeof(*domain));
-	domain->domain.F = calloc(vertex_words, sizeof(unsigned));
-	domain->F_len = vertex_words;
-
-	c = fgetc(fout);
-	if (c == '[')
-		fscanf(fout, "%d,%d:{", &a, &b);
-
-	while (fgetc(fout) == '{') {	/* '{' or closing '}' */
-	    int c;
-	    unsigned *F = calloc(words, sizeof(unsigned));
-
-	    for (j = 0; j < K->NbColumns; ++j) {
-		unsigned v, shift;
-		fscanf(fout, "%d", &v);
-		shift = INT_BITS - (v % INT_BITS) - 1;
-		F[v / INT_BITS] |= 1u << shift;
-		fgetc(fout); /* , or } */
+    T = Matrix_Copy(M);
+    Q = Constraints2Polyhedron(T, cw->options->MaxRays);
+    Matrix_Free(T);
+    POL_ENSURE_VERTICES(Q);
+
+    for (r = 0; domain->F_len && r < Q->NbRays; ++r) {
+	int n_tight = 0;
+	int k;
+
+	if (value_zero_p(Q->Ray[r][0]) || value_zero_p(Q->Ray[r][nvar+1]))
+	    continue;
+	for (i = cw->neq; i < cw->d; ++i) {
+	    Inner_Product(M->p[i]+1, Q->Ray[r]+1, nvar+1, &tmp);
+	    if (value_zero_p(tmp))
+		tight[n_tight++] = i;
+	}
+	if (n_tight < nfree)
+	    continue;
+
+	/* Enumerate the subsets of nfree tight inequalities */
+	for (k = 0; k < nfree; ++k)
+	    pos[k] = k;
+	while (domain->F_len) {
+	    unsigned *F = calloc(cw->words, sizeof(unsigned));
+	    for (i = 0; i < cw->neq; ++i)
+		F[i / INT_BITS] |= MSB >> (i % INT_BITS);
+	    for (k = 0; k < nfree; ++k) {
+		int t = tight[pos[k]];
+		F[t / INT_BITS] |= MSB >> (t % INT_BITS);
 	    }
-	    if (!domain->F_len)
+	    if (!feasible_basis(cw, F, tight, n_tight, pp))
 		free(F);
-	    else if (add_vertex_to_domain(&vertices, words, F, PP->Constraints,
-					  d, C->Dimension,
-					  domain, options->MaxRays))
-		++PP->nbV;
-	    if ((c = fgetc(fout)) != ',')	/* , or } */
-		ungetc(c, fout);
-	}
-	if (domain->F_len)
-	    vertex_words = domain->F_len;
-	if (c == '[')
-		fgetc(fout); /* ] */
-	fgetc(fout); /* ; */
-	fgetc(fout); /* \n */
-	if (bit_vector_count(domain->domain.F, domain->F_len) > 0)
-	    add_domain(&domains, domain, vertices, C, options);
-	else {
-	    options->stats->topcom_empty_chambers++;
-	    Param_Domain_Free(&domain->domain);
+	    else if (add_vertex_to_domain(&cw->vertices, cw->words, F,
+					  cw->Constraints, cw->d, cw->nparam,
+					  domain, cw->options->MaxRays))
+		++cw->PP->nbV;
+
+	    for (k = nfree-1; k >= 0 && pos[k] == n_tight-nfree+k; --k)
+		;
+	    if (k < 0)
+		break;
+	    ++pos[k];
+	    for (++k; k < nfree; ++k)
+		pos[k] = pos[k-1]+1;
 	}
     }
-    fclose(fout);
 
-    PP->V = vertices;
-    PP->D = &domains->domain;
+    Polyhedron_Free(Q);
+    Matrix_Free(M);
+    free(tight);
+    free(pos);
+    value_clear(tmp);
+}
 
-    remove_empty_chambers(&PP->D, vertex_words);
+static struct domain *find_domain(struct domain *domains, struct domain *domain)
+{
+    int i;
 
-    options->MaxRays = MaxRays;
+    for (; domains; domains = (struct domain *)domains->domain.next) {
+	for (i = 0; i < domains->F_len; ++i)
+	    if ((domains->domain.F[i] & domain->domain.F[i])
+			!= domain->domain.F[i])
+		break;
+	if (i < domains->F_len)
+	    continue;
+	for (; i < domain->F_len; ++i)
+	    if (domain->domain.F[i])
+		break;
+	if (i >= domain->F_len)
+	    return domains;
+    }
+    return NULL;
+}
 
-    return PP;
+/* Return the chamber containing the generic point pp,
+ * adding it to the list of chambers and to the queue
+ * of chambers to explore if it has not been seen before.
+ * Return NULL if the chamber is empty.
+ */
+static struct domain *chamber_at(struct chamber_walk *cw,
+				 struct perturbed_point *pp)
+{
+    struct domain *domain = ALLOC(struct domain);
+    struct domain *found;
+
+    memset(domain, 0, sizeof(*domain));
+    domain->domain.F = calloc(cw->vertex_words, sizeof(unsigned));
+    domain->F_len = cw->vertex_words;
+
+    add_active_vertices(cw, domain, pp);
+    if (domain->F_len)
+	cw->vertex_words = domain->F_len;
+    if (bit_vector_count(domain->domain.F, domain->F_len) == 0) {
+	cw->options->stats->topcom_empty_chambers++;
+	Param_Domain_Free(&domain->domain);
+	return NULL;
+    }
+    found = find_domain(cw->domains, domain);
+    if (found) {
+	cw->options->stats->topcom_chambers++;
+	Param_Domain_Free(&domain->domain);
+	return found;
+    }
+    add_domain(&cw->domains, domain, cw->vertices, cw->C, cw->options);
+    if (cw->n_queue >= cw->size_queue) {
+	cw->size_queue = 2 * cw->size_queue + 16;
+	cw->queue = realloc(cw->queue,
+			    cw->size_queue * sizeof(struct domain *));
+    }
+    cw->queue[cw->n_queue++] = domain;
+    return domain;
+}
+
+/* Does the affine function g vanish on the whole of Q?
+ */
+static int vanishes_on(Value *g, Polyhedron *Q)
+{
+    Value tmp;
+    int r;
+    int zero = 1;
+
+    value_init(tmp);
+    for (r = 0; zero && r < Q->NbRays; ++r) {
+	Inner_Product(g, Q->Ray[r]+1, Q->Dimension+1, &tmp);
+	if (value_notzero_p(tmp))
+	    zero = 0;
+    }
+    value_clear(tmp);
+    return zero;
 }
 
-/* Assumes M is of full row rank */
-static Matrix *null_space(Matrix *M)
+/* Find the chambers on the other side of the part Q of a facet
+ * of a chamber, where dir[0] of pp points to the other side.
+ * The chamber found at a relative interior point of Q may only
+ * cover part of Q, in which case the parts of Q outside
+ * of this chamber are explored recursively.
+ */
+static void cross_facet(struct chamber_walk *cw, Polyhedron *Q,
+			struct perturbed_point *pp)
 {
-    Matrix *H, *Q, *U;
-    Matrix *N;
+    struct domain *next;
+    Polyhedron *D;
+    Vector *row;
     int i;
 
-    left_hermite(M, &H, &Q, &U);
-    N = Matrix_Alloc(M->NbColumns, M->NbColumns - M->NbRows);
-    for (i = 0; i < N->NbRows; ++i)
-	Vector_Copy(U->p[i] + M->NbRows, N->p[i], N->NbColumns);
-    Matrix_Free(H);
-    Matrix_Free(Q);
-    Matrix_Free(U);
-    return N;
+    if (emptyQ(Q) || Q->NbEq != 1)
+	return;
+
+    pp->q = inner_point(Q);
+    if (!perturbed_in_domain(cw->C, pp)) {
+	Vector_Free(pp->q);
+	return;
+    }
+    next = chamber_at(cw, pp);
+    Vector_Free(pp->q);
+    if (!next)
+	return;
+
+    D = next->domain.Domain;
+    POL_ENSURE_VERTICES(Q);
+    row = Vector_Alloc(Q->Dimension+2);
+    for (i = D->NbEq; i < D->NbConstraints; ++i) {
+	Polyhedron *R;
+
+	if (vanishes_on(D->Constraint[i]+1, Q))
+	    continue;
+	value_set_si(row->p[0], 1);
+	Vector_Oppose(D->Constraint[i]+1, row->p+1, Q->Dimension+1);
+	R = AddConstraints(row->p, 1, Q, cw->options->MaxRays);
+	cross_facet(cw, R, pp);
+	Polyhedron_Free(R);
+    }
+    Vector_Free(row);
 }
 
-static void SwapColumns(Value **V, int n, int i, int j)
+/* Explore the neighbors of the chamber "domain" across each of its facets.
+ */
+static void explore_chamber(struct chamber_walk *cw, struct domain *domain)
 {
-    int r;
+    Polyhedron *D = domain->domain.Domain;
+    unsigned nparam = cw->nparam;
+    struct perturbed_point pp;
+    Vector *row;
+    int i;
+
+    POL_ENSURE_FACETS(D);
+    pp.dir = Matrix_Alloc(1+nparam, nparam);
+    for (i = 0; i < nparam; ++i)
+	value_set_si(pp.dir->p[1+i][i], 1);
+    row = Vector_Alloc(nparam+2);
+    for (i = D->NbEq; i < D->NbConstraints; ++i) {
+	Polyhedron *F;
 
-    for (r = 0; r < n; ++r)
-	value_swap(V[r][i], V[r][j]);
+	if (First_Non_Zero(D->Constraint[i]+1, nparam) == -1)
+	    continue;
+	Vector_Oppose(D->Constraint[i]+1, pp.dir->p[0], nparam);
+	Vector_Copy(D->Constraint[i]+1, row->p+1, nparam+1);
+	F = AddConstraints(row->p, 1, D, cw->options->MaxRays);
+	cross_facet(cw, F, &pp);
+	Polyhedron_Free(F);
+    }
+    Vector_Free(row);
+    Matrix_Free(pp.dir);
+}
+
+static void chamber_walk_init(struct chamber_walk *cw, Polyhedron *P,
+			      Polyhedron *C, struct barvinok_options *options)
+{
+    Param_Polyhedron *PP = ALLOC(Param_Polyhedron);
+
+    PP->Rays = NULL;
+    PP->nbV = 0;
+    PP->Constraints = Polyhedron2Constraints(P);
+
+    cw->C = C;
+    cw->Constraints = PP->Constraints;
+    cw->nparam = C->Dimension;
+    cw->d = PP->Constraints->NbRows;
+    cw->neq = P->NbEq;
+    cw->words = (cw->d+INT_BITS-1)/INT_BITS;
+    cw->vertex_words = 1;
+    cw->PP = PP;
+    cw->vertices = NULL;
+    cw->domains = NULL;
+    cw->queue = NULL;
+    cw->n_queue = 0;
+    cw->size_queue = 0;
+    cw->options = options;
+}
+
+static Param_Polyhedron *chamber_walk_finish(struct chamber_walk *cw)
+{
+    Param_Polyhedron *PP = cw->PP;
+
+    free(cw->queue);
+
+    PP->V = cw->vertices;
+    PP->D = &cw->domains->domain;
+
+    remove_empty_chambers(&PP->D, cw->vertex_words);
+
+    return PP;
+}
+
+/* Compute the chamber decomposition of P over C by starting
+ * from the chamber containing a generic point in the interior of C
+ * and then exploring neighboring chambers until no new chambers are found.
+ * The constraints of P are used as the potential facets of the vertices.
+ * Its equalities, if any, come first and are saturated by every vertex.
+ */
+static Param_Polyhedron *walk_chambers(Polyhedron *P, Polyhedron *C,
+				       struct barvinok_options *options)
+{
+    struct chamber_walk cw;
+    struct perturbed_point pp;
+    Param_Polyhedron *PP;
+    unsigned MaxRays = options->MaxRays;
+    int i;
+
+    /* We need the exact facets, because we may make some of them open later */
+    POL_UNSET(options->MaxRays, POL_INTEGER);
+
+    chamber_walk_init(&cw, P, C, options);
+
+    pp.q = inner_point(C);
+    pp.dir = Matrix_Alloc(cw.nparam, cw.nparam);
+    for (i = 0; i < cw.nparam; ++i)
+	value_set_si(pp.dir->p[i][i], 1);
+    chamber_at(&cw, &pp);
+    Vector_Free(pp.q);
+    Matrix_Free(pp.dir);
+
+    for (i = 0; i < cw.n_queue; ++i)
+	explore_chamber(&cw, cw.queue[i]);
+
+    PP = chamber_walk_finish(&cw);
+
+    options->MaxRays = MaxRays;
+
+    return PP;
 }
 
 /* C is assumed to be the "true" context, i.e., it has been intersected
  * with the projection of P onto the parameter space.
- * Furthermore, P and C are assumed to be full-dimensional.
+ * Furthermore, C is assumed to be full-dimensional.
+ * Any equalities of P therefore involve some of the variables.
  */
 Param_Polyhedron *TC_P2PP(Polyhedron *P, Polyhedron *C,
 			  struct barvinok_options *options)
 {
-    unsigned nparam = C->Dimension;
-    unsigned nvar = P->Dimension - C->Dimension;
-    int i, j;
-    Matrix *H;
-    Matrix *A;
-    Matrix *K;
-    int rows;
+    assert(C->NbEq == 0);
+
+    return walk_chambers(P, C, options);
+}
+
+/* Compute only the chambers of P over C that contain one of the points,
+ * given as the rows of "points".
+ * For a point on the boundary of several chambers, the chamber
+ * on the side of the interior point of C is chosen.
+ * Points outside of C are ignored.
+ * The same assumptions as for TC_P2PP apply.
+ */
+Param_Polyhedron *TC_P2PP_at_points(Polyhedron *P, Polyhedron *C,
+				    Matrix *points,
+				    struct barvinok_options *options)
+{
+    struct chamber_walk cw;
+    struct perturbed_point pp;
     Param_Polyhedron *PP;
-    Matrix M;
+    unsigned MaxRays = options->MaxRays;
+    unsigned nparam = C->Dimension;
+    Vector *interior;
+    Value one, mden;
+    int i;
 
     assert(C->NbEq == 0);
+    assert(points->NbColumns == nparam);
 
-    Polyhedron_Matrix_View(P, &M, P->NbConstraints);
-    H = standard_constraints(&M, nparam, &rows, NULL);
+    POL_UNSET(options->MaxRays, POL_INTEGER);
 
-    A = Matrix_Alloc(rows, nvar+rows);
-    for (i = nvar; i < H->NbRows; ++i) {
-	Vector_Oppose(H->p[i], A->p[i-nvar], H->NbColumns);
-	value_set_si(A->p[i-nvar][i], 1);
-    }
-    for (i = 0, j = H->NbRows-nvar; i < nvar; ++i) {
-	if (First_Non_Zero(H->p[i], i) == -1)
+    chamber_walk_init(&cw, P, C, options);
+
+    interior = inner_point(C);
+    value_init(one);
+    value_init(mden);
+    value_set_si(one, 1);
+    value_oppose(mden, interior->p[1+nparam]);
+    pp.q = Vector_Alloc(1+nparam+1);
+    pp.dir = Matrix_Alloc(1+nparam, nparam);
+    for (i = 0; i < nparam; ++i)
+	value_set_si(pp.dir->p[1+i][i], 1);
+    value_set_si(pp.q->p[1+nparam], 1);
+    for (i = 0; i < points->NbRows; ++i) {
+	Vector_Copy(points->p[i], pp.q->p+1, nparam);
+	Vector_Combine(interior->p+1, points->p[i], pp.dir->p[0],
+		       one, mden, nparam);
+	if (!perturbed_in_domain(C, &pp))
 	    continue;
-	Vector_Oppose(H->p[i], A->p[j], H->NbColumns);
-	value_set_si(A->p[j][j+nvar], 1);
-	SwapColumns(A->p, A->NbRows, j+nvar, i);
-	++j;
+	chamber_at(&cw, &pp);
     }
-    K = null_space(A);
-    Matrix_Free(A);
-    /* Ignore extra constraints */
-    K->NbRows = H->NbRows;
-    Matrix_Free(H);
-    PP = points2triangs(K, P, C, options);
-    Matrix_Free(K);
+    value_clear(one);
+    value_clear(mden);
+    Vector_Free(interior);
+    Vector_Free(pp.q);
+    Matrix_Free(pp.dir);
+
+    PP = chamber_walk_finish(&cw);
+
+    options->MaxRays = MaxRays;
+
     return PP;
 }
@@ -6,6 +6,9 @@ extern "C" {
 
 Param_Polyhedron *TC_P2PP(Polyhedron *P, Polyhedron *C,
 			  struct barvinok_options *options);
+Param_Polyhedron *TC_P2PP_at_points(Polyhedron *P, Polyhedron *C,
+				    Matrix *points,
+				    struct barvinok_options *options);
 
 #if defined(__cplusplus)
 }
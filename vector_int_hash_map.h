@@ -0,0 +1,59 @@
+#ifndef VECTOR_INT_HASH_MAP_H
+#define VECTOR_INT_HASH_MAP_H
+
+#include <vector>
+#include "config.h"
+
+/* HASH_MAP is a hash map template that can be used
+ * with std::vector<int> keys, falling back to std::map
+ * if no hash map is available.
+ */
+#if defined HAVE_UNORDERED_MAP
+
+#include <unordered_map>
+
+#define HASH_MAP std::unordered_map
+
+namespace std
+{
+        template<> struct hash< std::vector<int> >
+        {
+                size_t operator()( const std::vector<int>& x ) const
+                {
+			unsigned long __h = 0;
+			for (int i = 0; i < x.size(); ++i)
+			    __h = 5 * __h + x[i];
+                        return size_t(__h);
+                }
+        };
+}
+
+#elif defined HAVE_GNUCXX_HASHMAP
+
+#include <ext/hash_map>
+
+#define HASH_MAP __gnu_cxx::hash_map
+
+namespace __gnu_cxx
+{
+        template<> struct hash< std::vector<int> >
+        {
+                size_t operator()( const std::vector<int>& x ) const
+                {
+			unsigned long __h = 0;
+			for (int i = 0; i < x.size(); ++i)
+			    __h = 5 * __h + x[i];
+                        return size_t(__h);
+                }
+        };
+}
+
+#else
+
+#warning "no hash_map available"
+#include <map>
+#define HASH_MAP std::map
+
+#endif
+
+#endif
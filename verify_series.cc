@@ -1,20 +1,44 @@
+#include <vector>
 #include <barvinok/util.h>
 #include "skewed_genfun.h"
 #include "verify_series.h"
 
+/* The coefficients of gf are computed in a single batch for all
+ * parameter points visited by check_poly.  The points are therefore
+ * first collected in a separate pass and c contains the coefficients
+ * in the order in which check_poly visits the points.
+ */
 struct check_poly_gf_data {
     struct check_poly_data   cp;
     Polyhedron		    *S;
     const skewed_gen_fun    *gf;
     int	    	    	     exist;
+    Vector		    *c;
+    int			     next;
 };
 
+struct collect_points_data {
+    struct check_poly_data   cp;
+    std::vector<Vector *>    points;
+};
+
+static int collect_point(const struct check_poly_data *data, int nparam,
+			 Value *z, const struct verify_options *options)
+{
+    struct collect_points_data *cp_data;
+    cp_data = (struct collect_points_data *) data;
+    /* keep the homogeneous coordinate, which is needed if gf is skewed */
+    Vector *p = Vector_Alloc(nparam+1);
+    Vector_Copy(z, p->p, nparam+1);
+    cp_data->points.push_back(p);
+    return 1;
+}
+
 static int cp_gf(const struct check_poly_data *data, int nparam, Value *z,
 		 const struct verify_options *options)
 {
     Value c, tmp, one;
     struct check_poly_gf_data* gf_data = (struct check_poly_gf_data*) data;
-    const skewed_gen_fun *gf = gf_data->gf;
     int exist = gf_data->exist;
     Polyhedron *S = gf_data->S;
 
@@ -23,8 +47,8 @@ static int cp_gf(const struct check_poly_data *data, int nparam, Value *z,
     value_init(one);
     value_set_si(one, 1);
 
-    /* Computes the coefficient */
-    gf->coefficient(z, &c, options->barvinok);
+    /* Look up the coefficient */
+    value_assign(c, gf_data->c->p[gf_data->next++]);
 
     /* Manually count the number of points */
     count_points_e(1, S, exist, nparam, data->z, &tmp);
@@ -42,12 +66,35 @@ int check_poly_gf(Polyhedron *S, Polyhedron *CS, skewed_gen_fun *gf,
 		    int exist, int nparam, int pos, Value *z,
 		    const struct verify_options *options)
 {
+    struct collect_points_data collect;
+    struct verify_options collect_options = *options;
+    collect.cp.z = z;
+    collect.cp.check = collect_point;
+    /* avoid printing the progress twice */
+    collect_options.print_all = 1;
+    check_poly(CS, &collect.cp, nparam, pos, z+S->Dimension-nparam+1,
+		&collect_options);
+
+    int n = collect.points.size();
+    Matrix *points = Matrix_Alloc(n, nparam+1);
+    for (int i = 0; i < n; ++i) {
+	Vector_Copy(collect.points[i]->p, points->p[i], nparam+1);
+	Vector_Free(collect.points[i]);
+    }
+
     struct check_poly_gf_data data;
     data.cp.z = z;
     data.cp.check = cp_gf;
     data.S = S;
     data.gf = gf;
     data.exist = exist;
-    return check_poly(CS, &data.cp, nparam, pos, z+S->Dimension-nparam+1,
+    data.c = Vector_Alloc(n);
+    data.next = 0;
+    gf->coefficients(points, data.c->p, options->barvinok);
+    Matrix_Free(points);
+
+    int ok = check_poly(CS, &data.cp, nparam, pos, z+S->Dimension-nparam+1,
 			options);
+    Vector_Free(data.c);
+    return ok;
 }
@@ -34,11 +34,6 @@ const char *barvinok_version(void)
 #else
 	" -GLPK"
 #endif
-#ifdef POINTS2TRIANGS_PATH
-	" +TOPCOM"
-#else
-	" -TOPCOM"
-#endif
 #ifdef USE_ZSOLVE
 	" +ZSOLVE"
 #else
@@ -6,6 +6,7 @@
 #include <barvinok/util.h>
 #include "reduce_domain.h"
 #include "param_util.h"
+#include "parallel.h"
 #include "volume.h"
 #include "scale.h"
 
@@ -80,12 +81,117 @@ static evalue *determinant_cols(evalue ***matrix, int dim, int *cols)
     return det;
 }
 
-static evalue *determinant(evalue ***matrix, int dim)
+/* Return the sum of matrix[row][j] * v[j] for j < n.
+ */
+static evalue *row_product(evalue ***matrix, int row, int n, evalue **v)
+{
+    evalue *sum = evalue_zero();
+    int j;
+
+    for (j = 0; j < n; ++j) {
+	evalue *tmp = evalue_dup(v[j]);
+	emul(matrix[row][j], tmp);
+	eadd(tmp, sum);
+	evalue_free(tmp);
+    }
+    return sum;
+}
+
+/* Compute determinant using Berkowitz's division free algorithm.
+ * At the start of each iteration, c contains the coefficients
+ * of the characteristic polynomial of the leading r x r submatrix,
+ * starting from the leading coefficient.
+ * The characteristic polynomial of the leading (r+1) x (r+1) submatrix
+ * is obtained by multiplying this vector with the Toeplitz matrix
+ * whose first column is
+ *
+ *	[ 1, -a, -R S, -R A S, ..., -R A^{r-1} S ]
+ *
+ * where A is the leading r x r submatrix, S the top r elements
+ * of column r, R the first r elements of row r and a the diagonal
+ * element in row r.
+ * The determinant is (-1)^dim times the constant term.
+ *
+ * The number of multiplications is O(dim^4), rather than the
+ * O(dim!) of Laplace's formula.
+ */
+evalue *determinant_berkowitz(evalue ***matrix, int dim)
+{
+    evalue **c = ALLOCN(evalue *, dim+1);
+    evalue **next = ALLOCN(evalue *, dim+1);
+    evalue **t = ALLOCN(evalue *, dim+1);
+    evalue **v = ALLOCN(evalue *, dim);
+    evalue **w = ALLOCN(evalue *, dim);
+    evalue mone;
+    evalue *det;
+    int r, i, j, k;
+
+    value_init(mone.d);
+    evalue_set_si(&mone, -1, 1);
+
+    c[0] = evalue_zero();
+    evalue_set_si(c[0], 1, 1);
+    for (r = 0; r < dim; ++r) {
+	t[0] = c[0];
+	t[1] = evalue_dup(matrix[r][r]);
+	emul(&mone, t[1]);
+	for (i = 0; i < r; ++i)
+	    v[i] = evalue_dup(matrix[i][r]);
+	for (k = 0; k < r; ++k) {
+	    t[k+2] = row_product(matrix, r, r, v);
+	    emul(&mone, t[k+2]);
+	    if (k == r-1)
+		break;
+	    for (i = 0; i < r; ++i)
+		w[i] = row_product(matrix, i, r, v);
+	    for (i = 0; i < r; ++i) {
+		evalue_free(v[i]);
+		v[i] = w[i];
+	    }
+	}
+	for (i = 0; i < r; ++i)
+	    evalue_free(v[i]);
+
+	for (i = 0; i < r+2; ++i) {
+	    next[i] = evalue_zero();
+	    for (j = 0; j <= i && j <= r; ++j) {
+		evalue *tmp = evalue_dup(c[j]);
+		emul(t[i-j], tmp);
+		eadd(tmp, next[i]);
+		evalue_free(tmp);
+	    }
+	}
+	for (i = 1; i < r+2; ++i)
+	    evalue_free(t[i]);
+	for (i = 0; i < r+1; ++i)
+	    evalue_free(c[i]);
+	for (i = 0; i < r+2; ++i)
+	    c[i] = next[i];
+    }
+
+    det = c[dim];
+    for (i = 0; i < dim; ++i)
+	evalue_free(c[i]);
+    if (dim % 2)
+	emul(&mone, det);
+
+    free_evalue_refs(&mone);
+    free(c);
+    free(next);
+    free(t);
+    free(v);
+    free(w);
+
+    return det;
+}
+
+evalue *determinant_laplace(evalue ***matrix, int dim)
 {
     int i;
-    int *cols = ALLOCN(int, dim);
+    int *cols;
     evalue *det;
 
+    cols = ALLOCN(int, dim);
     for (i = 0; i < dim; ++i)
 	cols[i] = i;
 
@@ -96,6 +202,19 @@ static evalue *determinant(evalue ***matrix, int dim)
     return det;
 }
 
+/* Laplace's formula is only used for matrices up to this size.
+ * For larger matrices, Berkowitz's algorithm requires fewer
+ * multiplications.
+ */
+#define DETERMINANT_LAPLACE_MAX_DIM	4
+
+static evalue *determinant(evalue ***matrix, int dim)
+{
+    if (dim > DETERMINANT_LAPLACE_MAX_DIM)
+	return determinant_berkowitz(matrix, dim);
+    return determinant_laplace(matrix, dim);
+}
+
 /* Compute the facet of P that saturates constraint c.
  */
 static Polyhedron *facet(Polyhedron *P, int c, unsigned MaxRays)
@@ -258,6 +377,68 @@ static Matrix *triangulation_vertex(Param_Polyhedron *PP, Param_Domain *D,
     return NULL;
 }
 
+/* Return a copy of matrix with private copies of the first "rows" rows,
+ * for use in a computation that may run in a different thread.
+ * If only a single thread may be used, the computations run
+ * one after the other and they can all use matrix itself,
+ * as the rows beyond the first "rows" are only used as scratch space.
+ */
+static evalue ***matrix_copy_rows(evalue ***matrix, unsigned dim, int rows)
+{
+    int i, j;
+    evalue ***copy = ALLOCN(evalue **, dim+1);
+
+    for (i = 0; i < dim+1; ++i) {
+	copy[i] = ALLOCN(evalue *, dim);
+	if (i < rows)
+	    for (j = 0; j < dim; ++j)
+		copy[i][j] = evalue_dup(matrix[i][j]);
+    }
+    return copy;
+}
+
+static void matrix_free_rows(evalue ***matrix, unsigned dim, int rows)
+{
+    int i, j;
+
+    for (i = 0; i < dim+1; ++i) {
+	if (i < rows)
+	    for (j = 0; j < dim; ++j)
+		evalue_free(matrix[i][j]);
+	free(matrix[i]);
+    }
+    free(matrix);
+}
+
+/* Return the sum of the n (possibly NULL) volumes in v.
+ * The volumes are added pairwise in a balanced tree.
+ * The additions are performed in the calling thread, in a fixed order,
+ * such that the result does not depend on the number of threads
+ * used to compute the volumes.
+ */
+static evalue *volume_sum(evalue **v, int n)
+{
+    int step, a, b;
+
+    if (n == 0)
+	return NULL;
+
+    for (step = 1; step < n; step *= 2)
+	for (a = 0; a + step < n; a += 2 * step) {
+	    b = a + step;
+	    if (!v[b])
+		continue;
+	    if (!v[a])
+		v[a] = v[b];
+	    else {
+		eadd(v[b], v[a]);
+		evalue_free(v[b]);
+	    }
+	    v[b] = NULL;
+	}
+    return v[0];
+}
+
 /* Compute dim! times the volume of polyhedron F in Param_Domain D.
  * If F is a simplex, then the volume is computed of a recursive pyramid
  * over F with the points already in matrix.
@@ -274,14 +455,49 @@ static evalue *volume_in_domain(Param_Polyhedron *PP, Param_Domain *D,
 				int row, Polyhedron *F,
 				struct barvinok_options *options);
 
+/* The facets of a polyhedron that is triangulated by volume_triangulate,
+ * each of which is handled by a separate call to volume_facet,
+ * with the results stored in vol.
+ * The first "row" rows of matrix are shared by all facets
+ * and each facet works on a copy if "copy" is set.
+ */
+struct volume_facets_data {
+    Param_Polyhedron *PP;
+    unsigned dim;
+    evalue ***matrix;
+    int copy;
+    struct parameter_point *point;
+    int row;
+    Polyhedron **F;
+    Param_Domain **D;
+    evalue **vol;
+};
+
+static void volume_facet(int i, struct barvinok_options *options, void *user)
+{
+    struct volume_facets_data *data = (struct volume_facets_data *) user;
+    evalue ***matrix = data->matrix;
+
+    if (data->copy)
+	matrix = matrix_copy_rows(data->matrix, data->dim, data->row);
+    data->vol[i] = volume_in_domain(data->PP, data->D[i], data->dim, matrix,
+				    data->point, data->row, data->F[i],
+				    options);
+    if (data->copy)
+	matrix_free_rows(matrix, data->dim, data->row);
+}
+
+/* The facets of F are handled in parallel and their volumes
+ * are added in a tree reduction.
+ */
 static evalue *volume_triangulate(Param_Polyhedron *PP, Param_Domain *D,
 				  unsigned dim, evalue ***matrix,
 				  struct parameter_point *point,
 				  int row, Polyhedron *F,
 				  struct barvinok_options *options)
 {
-    int j;
-    evalue *tmp;
+    int j, n;
+    struct volume_facets_data data;
     evalue *vol;
     evalue mone;
     Matrix *center;
@@ -313,11 +529,18 @@ static evalue *volume_triangulate(Param_Polyhedron *PP, Param_Domain *D,
 	    eadd(matrix[0][j], matrix[row][j]);
     }
 
-    vol = NULL;
     POL_ENSURE_FACETS(F);
+    data.PP = PP;
+    data.dim = dim;
+    data.matrix = matrix;
+    data.copy = parallel_threads(options) > 1;
+    data.point = point;
+    data.row = row+1;
+    data.F = ALLOCN(Polyhedron *, F->NbConstraints);
+    data.D = ALLOCN(Param_Domain *, F->NbConstraints);
+    data.vol = ALLOCN(evalue *, F->NbConstraints);
+    n = 0;
     for (j = F->NbEq; j < F->NbConstraints; ++j) {
-	Polyhedron *FF;
-	Param_Domain *FD;
 	if (First_Non_Zero(F->Constraint[j]+1, dim) == -1)
 	    continue;
 	if (options->approx->volume_triangulate != BV_VOL_BARYCENTER) {
@@ -325,19 +548,21 @@ static evalue *volume_triangulate(Param_Polyhedron *PP, Param_Domain *D,
 	    if (First_Non_Zero(v->p+1, nparam+1) == -1)
 		continue;
 	}
-	FF = facet(F, j, options->MaxRays);
-	FD = Param_Polyhedron_Facet(PP, D, F->Constraint[j]);
-	tmp = volume_in_domain(PP, FD, dim, matrix, point,
-			       row+1, FF, options);
-	if (!vol)
-	    vol = tmp;
-	else {
-	    eadd(tmp, vol);
-	    evalue_free(tmp);
-	}
-	Polyhedron_Free(FF);
-	Param_Domain_Free(FD);
+	data.F[n] = facet(F, j, options->MaxRays);
+	data.D[n] = Param_Polyhedron_Facet(PP, D, F->Constraint[j]);
+	++n;
+    }
+
+    parallel_for_fn(n, &volume_facet, &data, options);
+    vol = volume_sum(data.vol, n);
+
+    for (j = 0; j < n; ++j) {
+	Polyhedron_Free(data.F[j]);
+	Param_Domain_Free(data.D[j]);
     }
+    free(data.F);
+    free(data.D);
+    free(data.vol);
 
     if (options->approx->volume_triangulate != BV_VOL_BARYCENTER)
 	Vector_Free(v);
@@ -397,6 +622,42 @@ static evalue *volume_simplex(Param_Polyhedron *PP, Param_Domain *D,
     return vol;
 }
 
+/* The simplices of a lifted triangulation, the volume of each of
+ * which is computed by a separate call to volume_simplex_task,
+ * with the results stored in vol.
+ * The first "row" rows of matrix are shared by all simplices
+ * and each simplex works on a copy if "copy" is set.
+ */
+struct volume_simplices_data {
+    Param_Polyhedron *PP;
+    unsigned dim;
+    evalue ***matrix;
+    int copy;
+    struct parameter_point *point;
+    int row;
+    Param_Domain *SD;
+    evalue **vol;
+};
+
+static void volume_simplex_task(int i, struct barvinok_options *options,
+				void *user)
+{
+    struct volume_simplices_data *data;
+    evalue ***matrix;
+
+    data = (struct volume_simplices_data *) user;
+    matrix = data->matrix;
+    if (data->copy)
+	matrix = matrix_copy_rows(data->matrix, data->dim, data->row);
+    data->vol[i] = volume_simplex(data->PP, &data->SD[i], data->dim, matrix,
+				  data->point, data->row, options);
+    if (data->copy)
+	matrix_free_rows(matrix, data->dim, data->row);
+}
+
+/* The volumes of the simplices are computed in parallel
+ * and added in a tree reduction.
+ */
 static evalue *volume_triangulate_lift(Param_Polyhedron *PP, Param_Domain *D,
 					unsigned dim, evalue ***matrix,
 					struct parameter_point *point,
@@ -405,18 +666,16 @@ static evalue *volume_triangulate_lift(Param_Polyhedron *PP, Param_Domain *D,
     const static int MAX_TRY=10;
     Param_Vertices *V;
     int nbV, nv;
-    int i;
+    int i, n;
     int t = 0;
     Matrix *FixedRays, *M;
     Polyhedron *L;
-    Param_Domain SD;
+    Param_Domain *SD;
     Value tmp;
-    evalue *s, *vol;
+    evalue *vol;
+    struct volume_simplices_data data;
 
-    SD.Domain = 0;
-    SD.next = 0;
     nv = (PP->nbV - 1)/(8*sizeof(int)) + 1;
-    SD.F = ALLOCN(unsigned, nv);
 
     FixedRays = Matrix_Alloc(PP->nbV+1, 1+dim+2);
     nbV = 0;
@@ -441,16 +700,16 @@ static evalue *volume_triangulate_lift(Param_Polyhedron *PP, Param_Domain *D,
     FixedRays->NbRows = nbV+1;
 
     value_init(tmp);
+    SD = NULL;
     if (0) {
 try_again:
-	/* Usually vol should still be NULL */
-	if (vol)
-	    evalue_free(vol);
+	for (i = 0; i < n; ++i)
+	    free(SD[i].F);
+	free(SD);
 	Polyhedron_Free(L);
 	++t;
     }
     assert(t <= MAX_TRY);
-    vol = NULL;
 
     for (i = 0; i < nbV; ++i)
 	value_set_si(FixedRays->p[i][1+dim], random_int((t+1)*dim*nbV)+1);
@@ -460,13 +719,19 @@ try_again:
     Matrix_Free(M);
 
     POL_ENSURE_FACETS(L);
+    SD = ALLOCN(Param_Domain, L->NbConstraints);
+    n = 0;
     for (i = 0; i < L->NbConstraints; ++i) {
 	int r;
 	/* Ignore perpendicular facets, i.e., facets with 0 z-coordinate */
 	if (value_negz_p(L->Constraint[i][1+dim]))
 	    continue;
 
-	memset(SD.F, 0, nv * sizeof(unsigned));
+	SD[n].Domain = NULL;
+	SD[n].next = NULL;
+	SD[n].F = ALLOCN(unsigned, nv);
+	memset(SD[n].F, 0, nv * sizeof(unsigned));
+	++n;
 	nbV = 0;
 	r = 0;
 	FORALL_PVertex_in_ParamPolyhedron(V, D, PP) /* _ix, _bx internal */
@@ -474,25 +739,32 @@ try_again:
 	    if (value_zero_p(tmp)) {
 		if (r > dim-row)
 		    goto try_again;
-		SD.F[_ix] |= _bx;
+		SD[n-1].F[_ix] |= _bx;
 		++r;
 	    }
 	    ++nbV;
 	END_FORALL_PVertex_in_ParamPolyhedron;
 	assert(r == (dim-row)+1);
-
-	s = volume_simplex(PP, &SD, dim, matrix, point, row, options);
-	if (!vol)
-	    vol = s;
-	else {
-	    eadd(s, vol);
-	    evalue_free(s);
-	}
     }
     Polyhedron_Free(L);
     Matrix_Free(FixedRays);
     value_clear(tmp);
-    free(SD.F);
+
+    data.PP = PP;
+    data.dim = dim;
+    data.matrix = matrix;
+    data.copy = parallel_threads(options) > 1;
+    data.point = point;
+    data.row = row;
+    data.SD = SD;
+    data.vol = ALLOCN(evalue *, n);
+    parallel_for_fn(n, &volume_simplex_task, &data, options);
+    vol = volume_sum(data.vol, n);
+    free(data.vol);
+
+    for (i = 0; i < n; ++i)
+	free(SD[i].F);
+    free(SD);
 
     return vol;
 }
@@ -590,6 +862,8 @@ evalue* Param_Polyhedron_Volume(Polyhedron *P, Polyhedron* C,
 	Domain_Free(CA);
 
 	point = non_empty_point(D);
+	/* Construct the evalues of point before they are shared by threads */
+	parameter_point_evalue(point);
 	s[i].D = rVD;
 	s[i].E = volume_in_domain(PP, D, nvar, matrix, point, 0, F, options);
 	Domain_Free(F);
@@ -6,6 +6,12 @@ extern "C" {
 
 struct barvinok_options;
 
+/* Determinant of a dim x dim matrix of evalues, computed using
+ * Laplace's formula or Berkowitz's division free algorithm.
+ */
+evalue *determinant_laplace(evalue ***matrix, int dim);
+evalue *determinant_berkowitz(evalue ***matrix, int dim);
+
 evalue* Param_Polyhedron_Volume(Polyhedron *P, Polyhedron* C,
 				struct barvinok_options *options);
 
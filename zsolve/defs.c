@@ -24,7 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 //                                                                            //
 
-int _gcd(int a, int b)
+vector_t _gcd(vector_t a, vector_t b)
 {
 	if (b!=0)
 		return _gcd(b, a % b);
@@ -34,7 +34,7 @@ int _gcd(int a, int b)
 
 //                                                                            //
 
-int gcd(int a, int b)
+vector_t gcd(vector_t a, vector_t b)
 {
 	if (a<0)
 		a *= -1;
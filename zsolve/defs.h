@@ -45,12 +45,51 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 # define MAXINT ((int)(~(unsigned)0 >> 1))
 #endif
 
+// entries of vectors and matrices
+// the library is built once with int and once with long long entries,
+// in which case all external symbols are renamed (see int64.h)
+
+#ifdef ZSOLVE_INT64
+typedef long long vector_t;
+# define VECTOR_T_MAX ((vector_t)(~0ULL >> 1))
+# define VECTOR_T_FORMAT(width) "%" width "lld"
+# include "int64.h"
+#else
+typedef int vector_t;
+# define VECTOR_T_MAX MAXINT
+# define VECTOR_T_FORMAT(width) "%" width "d"
+#endif
 
-int gcd(int, int);
+// overflow checked arithmetic on entries in [-VECTOR_T_MAX, VECTOR_T_MAX],
+// setting *overflow if the result does not lie in this range
+
+static inline vector_t addChecked(vector_t a, vector_t b, bool *overflow)
+{
+	if ((b>0 && a>VECTOR_T_MAX-b) || (b<0 && a<-VECTOR_T_MAX-b))
+	{
+		*overflow = true;
+		return 0;
+	}
+	return a+b;
+}
+
+static inline vector_t mulChecked(vector_t a, vector_t b, bool *overflow)
+{
+	if (a!=0 && b!=0 && (a<0 ? -a : a)>VECTOR_T_MAX/(b<0 ? -b : b))
+	{
+		*overflow = true;
+		return 0;
+	}
+	return a*b;
+}
+
+vector_t gcd(vector_t, vector_t);
 
 #define minm(x,y) ( ((x)<(y)) ? (x) : (y) )
 int mini(int, int);
 #define maxm(x,y) ( ((x)>(y)) ? (x) : (y) )
+#define absm(x) ( ((x)<0) ? -(x) : (x) )
+#define signm(x) ( ((x)>0) - ((x)<0) )
 int maxi(int, int);
 double maxd(double, double);
 
@@ -0,0 +1,107 @@
+/*
+Renaming of the external symbols of the instance of zsolve
+with long long entries (ZSOLVE_INT64), such that it can be linked
+together with the default instance with int entries.
+The functions in indexarray.c, pool.c and cputime.c do not depend on the type
+of the entries and are shared by both instances.
+*/
+
+#ifndef _INT64_H
+#define _INT64_H
+
+#define _gcd _gcd64
+#define gcd gcd64
+#define mini mini64
+#define maxi maxi64
+#define maxd maxd64
+#define createVector createVector64
+#define createZeroVector createZeroVector64
+#define deleteVector deleteVector64
+#define copyVector copyVector64
+#define fprintVector fprintVector64
+#define printVector printVector64
+#define readVector readVector64
+#define normVector normVector64
+#define swapVector swapVector64
+#define gcdVector gcdVector64
+#define lexCompareInverseVector lexCompareInverseVector64
+#define createVectorArray createVectorArray64
+#define deleteVectorArray deleteVectorArray64
+#define fprintVectorArray fprintVectorArray64
+#define printVectorArray printVectorArray64
+#define appendToVectorArray appendToVectorArray64
+#define swapVectorArrayRows swapVectorArrayRows64
+#define swapVectorArrayColumns swapVectorArrayColumns64
+#define appendVectorArrayNegatives appendVectorArrayNegatives64
+#define sortVectorArrayColumns sortVectorArrayColumns64
+#define readVectorArray readVectorArray64
+#define createLinearSystem createLinearSystem64
+#define deleteLinearSystem deleteLinearSystem64
+#define setLinearSystemSize setLinearSystemSize64
+#define setLinearSystemMatrix setLinearSystemMatrix64
+#define setLinearSystemRHS setLinearSystemRHS64
+#define setLinearSystemLimit setLinearSystemLimit64
+#define setLinearSystemBound setLinearSystemBound64
+#define setLinearSystemEquationType setLinearSystemEquationType64
+#define imax imax64
+#define numberSize numberSize64
+#define equationSize equationSize64
+#define propertySize propertySize64
+#define fprintLinearSystem fprintLinearSystem64
+#define printLinearSystem printLinearSystem64
+#define homogenizeLinearSystem homogenizeLinearSystem64
+#define generateLattice generateLattice64
+#define createMatrix createMatrix64
+#define createIdentityMatrix createIdentityMatrix64
+#define deleteMatrix deleteMatrix64
+#define readMatrix readMatrix64
+#define fprintMatrix fprintMatrix64
+#define printMatrix printMatrix64
+#define swapMatrixRows swapMatrixRows64
+#define swapMatrixColumns swapMatrixColumns64
+#define negateMatrixColumn negateMatrixColumn64
+#define combineMatrixColumns combineMatrixColumns64
+#define copyMatrix copyMatrix64
+#define createVariableProperties createVariableProperties64
+#define deleteVariableProperties deleteVariableProperties64
+#define checkVariableSymmetry checkVariableSymmetry64
+#define checkVariableFree checkVariableFree64
+#define checkVariableBounds checkVariableBounds64
+#define swapVariableProperties swapVariableProperties64
+#define fprintVariableProperties fprintVariableProperties64
+#define readVariableProperties readVariableProperties64
+#define createValueTree createValueTree64
+#define deleteValueTree deleteValueTree64
+#define splitValueTree splitValueTree64
+#define createValueTrees createValueTrees64
+#define deleteValueTrees deleteValueTrees64
+#define enumValueReducer enumValueReducer64
+#define insertVectorToValueTree insertVectorToValueTree64
+#define insertVectorToValueTrees insertVectorToValueTrees64
+#define copySumToPool copySumToPool64
+#define insertValueSum insertValueSum64
+#define buildValueSum buildValueSum64
+#define enumValueSecond enumValueSecond64
+#define enumValueFirst enumValueFirst64
+#define collectValueFirst collectValueFirst64
+#define completeValueFirst completeValueFirst64
+#define mergeValueCandidates mergeValueCandidates64
+#define completeValueTreesParallel completeValueTreesParallel64
+#define completeValueTrees completeValueTrees64
+#define chooseNext chooseNext64
+#define nextVariable nextVariable64
+#define filterLimits filterLimits64
+#define zsolveLogCallbackDefault zsolveLogCallbackDefault64
+#define splitLog splitLog64
+#define poolLog poolLog64
+#define poolLatticeVectors poolLatticeVectors64
+#define backupZSolveContext backupZSolveContext64
+#define originalCompare originalCompare64
+#define setZSolveContextParallel setZSolveContextParallel64
+#define createZSolveContextFromSystem createZSolveContextFromSystem64
+#define createZSolveContextFromLattice createZSolveContextFromLattice64
+#define createZSolveContextFromBackup createZSolveContextFromBackup64
+#define zsolveSystem zsolveSystem64
+#define deleteZSolveContext deleteZSolveContext64
+
+#endif
@@ -32,10 +32,12 @@ VectorArray generateLattice(LinearSystem system)
 {
 	int i,j,k;
 	int n,e;
-	int currentindex, bestindex, currentvalue, bestvalue;
+	int currentindex, bestindex;
+	vector_t currentvalue, bestvalue;
 	int identities;
-	int factor;
+	vector_t factor;
 	bool flag;
+	bool overflow = false;
 	VectorArray array;
 	Matrix H,I,C;
 	Vector vec;
@@ -69,7 +71,7 @@ VectorArray generateLattice(LinearSystem system)
 		k = -1;
 		for (j=0; j<e-identities; j++)
 		{
-			if (k==-1 && abs(H->Data[i+j*n])==1)
+			if (k==-1 && (H->Data[i+j*n]==1 || H->Data[i+j*n]==-1))
 				k = j;
 			else if (H->Data[i+j*n]!=0)
 			{
@@ -127,7 +129,9 @@ VectorArray generateLattice(LinearSystem system)
 				bestvalue = 0;
 				for (currentindex=i; currentindex<n; currentindex++)
 				{
-					currentvalue = abs(H->Data[currentindex+H->Width*i]);
+					currentvalue = H->Data[currentindex+H->Width*i];
+					if (currentvalue<0)
+						currentvalue = -currentvalue;
 					if (currentvalue!=0 && (bestvalue<=0 || currentvalue<bestvalue))
 					{
 						bestindex = currentindex;
@@ -152,11 +156,16 @@ VectorArray generateLattice(LinearSystem system)
 						factor = H->Data[j+H->Width*i] / -bestvalue;
 						if (H->Data[j+H->Width*i] % bestvalue != 0 && j>i)
 							flag = true;
-						combineMatrixColumns(H, j, factor, bestindex);
-						combineMatrixColumns(I, j, factor, bestindex);
+						if (combineMatrixColumns(H, j, factor, bestindex))
+							overflow = true;
+						if (combineMatrixColumns(I, j, factor, bestindex))
+							overflow = true;
 					}
 				}
-			} while (flag);
+			} while (flag && !overflow);
+
+			if (overflow)
+				break;
 
 			if (bestindex!=i)
 			{
@@ -165,7 +174,7 @@ VectorArray generateLattice(LinearSystem system)
 			}
 		}
 
-		while (i<n)
+		while (i<n && !overflow)
 		{
 			vec = createVector(H->Width);
 			// fill from I
@@ -176,8 +185,8 @@ VectorArray generateLattice(LinearSystem system)
 			{
 				factor = 0;
 				for (k=0; k<n; k++)
-					factor -= vec[k]*C->Data[C->Width*(e+j)+k];
-				vec[n+j] = factor*H->Data[H->Width*(e+j)+n+j];
+					factor = addChecked(factor, -mulChecked(vec[k], C->Data[C->Width*(e+j)+k], &overflow), &overflow);
+				vec[n+j] = mulChecked(factor, H->Data[H->Width*(e+j)+n+j], &overflow);
 			}
 			appendToVectorArray(array, vec);
 			i++;
@@ -188,6 +197,12 @@ VectorArray generateLattice(LinearSystem system)
 	deleteMatrix(H);
 	deleteMatrix(C);
 
+	if (overflow)
+	{
+		deleteVectorArray(array);
+		return NULL;
+	}
+
 	return array;
 }
 
@@ -27,6 +27,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "linearsystem.h"
 
 VectorArray generateLattice(LinearSystem);
-/* Generates a lattice with Hermite Normal Form from a given linear system. (system) */
+/* Generates a lattice with Hermite Normal Form from a given linear system, NULL on overflow. (system) */
 
 #endif 
@@ -27,7 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "valuetrees.h"
 #include "lattice.h"
 
-int chooseNext(ZSolveContext ctx, Vector possible, int value)
+int chooseNext(ZSolveContext ctx, Vector possible, vector_t value)
 {
 	int i,j,zeros;
 
@@ -58,7 +58,7 @@ int nextVariable(ZSolveContext ctx)
 	IndexArray Zeros;
 	Vector gcds;
 	int i,j,k,col = -1;
-	int factor, value;
+	vector_t factor, value;
 	bool flag;
 
 	assert(ctx);
@@ -79,9 +79,9 @@ int nextVariable(ZSolveContext ctx)
 		{
 			if (!ctx->Lattice->Properties[i].Free)
 			{
-				gcds[i] = abs(ctx->Lattice->Data[Zeros->Data[0]][i]);
+				gcds[i] = absm(ctx->Lattice->Data[Zeros->Data[0]][i]);
 				for (j=1; j<Zeros->Size; j++)
-					gcds[i] = gcd(gcds[i], abs(ctx->Lattice->Data[Zeros->Data[j]][i]));
+					gcds[i] = gcd(gcds[i], ctx->Lattice->Data[Zeros->Data[j]][i]);
 				if ((value<0 || gcds[i]<value) && gcds[i]>0)
 					value = gcds[i];
 			}
@@ -98,7 +98,7 @@ int nextVariable(ZSolveContext ctx)
 			j = -1;
 			for (i=0; i<Zeros->Size; i++)
 			{
-				if (ctx->Lattice->Data[Zeros->Data[i]][col]!=0 && (j<0 || abs(ctx->Lattice->Data[Zeros->Data[i]][col])<abs(ctx->Lattice->Data[Zeros->Data[j]][col])))
+				if (ctx->Lattice->Data[Zeros->Data[i]][col]!=0 && (j<0 || absm(ctx->Lattice->Data[Zeros->Data[i]][col])<absm(ctx->Lattice->Data[Zeros->Data[j]][col])))
 					j = i;
 			}
 			if (j<0)
@@ -128,10 +128,10 @@ int nextVariable(ZSolveContext ctx)
 						flag = true;
 					}
 					for (k=0; k<ctx->Variables; k++)
-						ctx->Lattice->Data[i][k] -= factor * ctx->Lattice->Data[j][k];
+						ctx->Lattice->Data[i][k] = addChecked(ctx->Lattice->Data[i][k], -mulChecked(factor, ctx->Lattice->Data[j][k], &ctx->Overflow), &ctx->Overflow);
 				}
 			}
-		} while (flag);
+		} while (flag && !ctx->Overflow);
 	}
 	else
 	{
@@ -155,10 +155,10 @@ void filterLimits(ZSolveContext ctx)
 
 	for (i=0; i<ctx->Lattice->Size; i++)
 	{
-		if (ctx->Lattice->Properties[ctx->Current].Lower>ctx->Lattice->Data[i][ctx->Current] || ctx->Lattice->Properties[ctx->Current].Upper<ctx->Lattice->Data[i][ctx->Current])
+		if (!checkVariableBounds(ctx->Lattice->Properties, ctx->Current, ctx->Lattice->Data[i][ctx->Current]))
 		{
 			ctx->Lattice->Size--;
-			deleteVector(ctx->Lattice->Data[i]);
+			releaseToPool(ctx->VectorPool, ctx->Lattice->Data[i]);
 			ctx->Lattice->Data[i] = ctx->Lattice->Data[ctx->Lattice->Size];
 			i--;
 		}
@@ -254,6 +254,8 @@ void zsolveLogCallbackDefault(FILE *stream, int level, int type, int var, int su
 		{
 			// need homs / inhoms - maybe with va
 		}
+		else if (type == ZSOLVE_LOG_POOLS && level>1)
+			fprintf(stream, "\nAllocated at most %d value trees, %d value tree nodes and %d vectors.\n", sum, norm, vectors);
 	}
 	if (stream)
 		fflush(stream);
@@ -272,6 +274,40 @@ void splitLog(ZSolveContext ctx, int type, CPUTime steptime)
 	}
 }
 
+void poolLog(ZSolveContext ctx)
+{
+	CPUTime currenttime = getCPUTime();
+
+	if (ctx->LogCallback)
+	{
+		ctx->LogCallback(stdout, ctx->Verbosity, ZSOLVE_LOG_POOLS, ctx->Current, ctx->TreePool->HighWater, ctx->NodePool->HighWater, ctx->VectorPool->HighWater, maxd(currenttime - ctx->AllTime, 0.0), 0.0);
+		if (ctx->LogFile)
+			ctx->LogCallback(ctx->LogFile, ctx->LogLevel, ZSOLVE_LOG_POOLS, ctx->Current, ctx->TreePool->HighWater, ctx->NodePool->HighWater, ctx->VectorPool->HighWater, maxd(currenttime - ctx->AllTime, 0.0), 0.0);
+	}
+}
+
+// move the vectors of the lattice into the vector pool,
+// such that all of them can be released at once
+
+void poolLatticeVectors(ZSolveContext ctx)
+{
+	int i,j;
+	Vector vector;
+
+	ctx->TreePool = createPool(sizeof(valuetree_t));
+	ctx->NodePool = createPool(sizeof(valuetreenode_t));
+	ctx->VectorPool = createPool(ctx->Variables*sizeof(vector_t));
+
+	for (i=0; i<ctx->Lattice->Size; i++)
+	{
+		vector = (Vector)allocFromPool(ctx->VectorPool);
+		for (j=0; j<ctx->Variables; j++)
+			vector[j] = ctx->Lattice->Data[i][j];
+		deleteVector(ctx->Lattice->Data[i]);
+		ctx->Lattice->Data[i] = vector;
+	}
+}
+
 void backupZSolveContext(FILE *stream, ZSolveContext ctx)
 {
 	CPUTime currenttime = getCPUTime();
@@ -297,6 +333,12 @@ int originalCompare(int a, int b)
 	return a-b;
 }
 
+void setZSolveContextParallel(ZSolveContext ctx, ZSolveParallelCallback callback, void *data)
+{
+	ctx->ParallelCallback = callback;
+	ctx->ParallelData = data;
+}
+
 ZSolveContext createZSolveContextFromSystem(LinearSystem initialsystem, FILE *logfile, int loglevel, int verbosity, ZSolveLogCallback logcallback, ZSolveBackupCallback backupcallback)
 {
 	ZSolveContext ctx;
@@ -341,7 +383,13 @@ ZSolveContext createZSolveContextFromSystem(LinearSystem initialsystem, FILE *lo
 		fprintf(ctx->LogFile, "\n\n");
 	}
 
+	ctx->Overflow = false;
 	ctx->Lattice = generateLattice(finalsystem);
+	if (ctx->Lattice==NULL)
+	{
+		ctx->Overflow = true;
+		ctx->Lattice = createVectorArray(finalsystem->Variables);
+	}
 	deleteLinearSystem(finalsystem);
 
 	// sort 0, 1, 2, ... , -2, -2, -2, -2, -1 (original order, then slackvars, then -b)
@@ -357,6 +405,12 @@ ZSolveContext createZSolveContextFromSystem(LinearSystem initialsystem, FILE *lo
 	ctx->AllTime = getCPUTime();
 	ctx->BackupCallback = backupcallback;
 	ctx->LogCallback = logcallback;
+	ctx->Candidates = NULL;
+	ctx->ParallelCallback = NULL;
+	ctx->ParallelData = NULL;
+	ctx->TreePool = NULL;
+	ctx->NodePool = NULL;
+	ctx->VectorPool = NULL;
 	ctx->Homs = NULL;
 	ctx->Inhoms = NULL;
 	ctx->Frees = NULL;
@@ -382,6 +436,7 @@ ZSolveContext createZSolveContextFromLattice(VectorArray lattice, FILE *logfile,
 	ctx->Verbosity = verbosity;
 	ctx->LogLevel = loglevel;
 	ctx->LogFile = logfile;
+	ctx->Overflow = false;
 	ctx->Lattice = lattice;
 	ctx->Variables = ctx->Lattice->Variables;
 	ctx->MaxNorm = 0;
@@ -392,6 +447,12 @@ ZSolveContext createZSolveContextFromLattice(VectorArray lattice, FILE *logfile,
 	ctx->AllTime = getCPUTime();
 	ctx->BackupCallback = backupcallback;
 	ctx->LogCallback = logcallback;
+	ctx->Candidates = NULL;
+	ctx->ParallelCallback = NULL;
+	ctx->ParallelData = NULL;
+	ctx->TreePool = NULL;
+	ctx->NodePool = NULL;
+	ctx->VectorPool = NULL;
 	ctx->Homs = NULL;
 	ctx->Inhoms = NULL;
 	ctx->Frees = NULL;
@@ -425,12 +486,19 @@ ZSolveContext createZSolveContextFromBackup(FILE *stream, ZSolveLogCallback logc
 	ctx->SumTime = currenttime - ctx->SumTime;
 	ctx->NormTime = currenttime - ctx->NormTime;
 
+	ctx->Overflow = false;
 	ctx->Lattice = readVectorArray(stream, true);
 
 	ctx->Variables = ctx->Lattice->Variables;
 
 	ctx->BackupCallback = backupcallback;
 	ctx->LogCallback = logcallback;
+	ctx->Candidates = NULL;
+	ctx->ParallelCallback = NULL;
+	ctx->ParallelData = NULL;
+	ctx->TreePool = NULL;
+	ctx->NodePool = NULL;
+	ctx->VectorPool = NULL;
 	ctx->Homs = NULL;
 	ctx->Inhoms = NULL;
 	ctx->Frees = NULL;
@@ -453,6 +521,7 @@ void zsolveSystem(ZSolveContext ctx, bool appendnegatives)
 	if (appendnegatives)
 		appendVectorArrayNegatives(ctx->Lattice);
 
+	poolLatticeVectors(ctx);
 	ctx->Sum = createVector(ctx->Variables);
 
 	if (ctx->SumNorm != 0)
@@ -471,7 +540,7 @@ void zsolveSystem(ZSolveContext ctx, bool appendnegatives)
 			ctx->VarTime = getCPUTime();
 			next = nextVariable(ctx);
 //			printf("next variable = %d\n", next);
-			if (next<0)
+			if (next<0 || ctx->Overflow)
 				break;
 			splitLog(ctx, ZSOLVE_LOG_VARIABLE_STARTED, 0.0);
 			swapVectorArrayColumns(ctx->Lattice, next, ctx->Current);
@@ -500,6 +569,12 @@ void zsolveSystem(ZSolveContext ctx, bool appendnegatives)
 
 		// end of norm loop
 
+		if (ctx->Overflow)
+		{
+			deleteValueTrees(ctx);
+			break;
+		}
+
 		splitLog(ctx, ZSOLVE_LOG_NORM_FINISHED, ctx->NormTime);
 		ctx->FirstNorm++;
 	
@@ -529,6 +604,11 @@ void zsolveSystem(ZSolveContext ctx, bool appendnegatives)
 
 	// algorithm completed
 
+	poolLog(ctx);
+
+	if (ctx->Overflow)
+		return;
+
 	split = -1;
 	count = 0;
 
@@ -614,7 +694,13 @@ void zsolveSystem(ZSolveContext ctx, bool appendnegatives)
 void deleteZSolveContext(ZSolveContext ctx, bool deleteresult)
 {
 	deleteVector(ctx->Sum);
+	// the vectors of the lattice belong to the vector pool
+	if (ctx->VectorPool)
+		ctx->Lattice->Size = 0;
 	deleteVectorArray(ctx->Lattice);
+	deletePool(ctx->TreePool);
+	deletePool(ctx->NodePool);
+	deletePool(ctx->VectorPool);
 
 	if (deleteresult)
 	{
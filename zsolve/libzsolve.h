@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "vectorarray.h"
 #include "linearsystem.h"
 #include "cputime.h"
+#include "pool.h"
 
 /*** solve-internal data ***/
 
@@ -51,6 +52,7 @@ typedef struct zsolvecontext_t
 	Vector Sum;
 
 	bool Symmetric;
+	bool Overflow;
 
 	FILE *LogFile;
 	int LogLevel;
@@ -63,6 +65,14 @@ typedef struct zsolvecontext_t
 
 	int BackupTime;
 
+	Pool TreePool;
+	Pool NodePool;
+	Pool VectorPool;
+
+	VectorArray Candidates;
+	void (*ParallelCallback)(int, void (*)(int, void *), void *, void *);
+	void *ParallelData;
+
 	void (*LogCallback)(FILE *, int level, int type, int var, int sum, int norm, int vectors, CPUTime alltime, CPUTime steptime);
 	void (*BackupCallback)(struct zsolvecontext_t *);
 } zsolvecontext_t;
@@ -80,9 +90,11 @@ typedef zsolvecontext_t *ZSolveContext;
 #define ZSOLVE_LOG_NORM_STARTED 6
 #define ZSOLVE_LOG_NORM_FINISHED 7
 #define ZSOLVE_LOG_FINISHED 8
+#define ZSOLVE_LOG_POOLS 9
 
 typedef void (*ZSolveLogCallback)(FILE *, int level, int type, int var, int sum, int norm, int vectors, CPUTime alltime, CPUTime steptime);
 /* (stream, loglevel, log_type, current variable, current sum, current norm, number of vectors, cumulative time, time of logged step) */
+/* for ZSOLVE_LOG_POOLS, sum, norm and vectors are the maximal numbers of value trees, value tree nodes and lattice vectors allocated at the same time */
 
 void zsolveLogCallbackDefault(FILE *, int, int, int, int, int, int, CPUTime, CPUTime);
 /* (stream, loglevel, log_type, current variable, current sum, current norm, number of vectors, cumulative time, time of logged step) */
@@ -95,6 +107,14 @@ typedef void (*ZSolveBackupCallback)(ZSolveContext);
 void backupZSolveContext(FILE *, ZSolveContext);
 /* (backupfile, current context) */
 
+/*** parallel completion ***/
+
+typedef void (*ZSolveParallelCallback)(int, void (*)(int, void *), void *, void *);
+/* (number of tasks, task, task data, parallel data) should call task(i, task data) for each i = 0..number of tasks-1, possibly concurrently */
+
+void setZSolveContextParallel(ZSolveContext, ZSolveParallelCallback, void *);
+/* (context, parallel callback, parallel data passed to the callback) */
+
 /*** main calls ***/
 ZSolveContext createZSolveContextFromSystem(LinearSystem, FILE *, int, int, ZSolveLogCallback, ZSolveBackupCallback);
 /* (system to solve, logfile, loglevel = 0..3, verbosity = 0..3, custom log callback or zsolveLogCallbackDefault, backup callback) */
@@ -107,6 +127,7 @@ ZSolveContext createZSolveContextFromBackup(FILE *, ZSolveLogCallback, ZSolveBac
 
 void zsolveSystem(ZSolveContext, bool);
 /* (context created by createZSolveContext or resumeZSolveContext, append negatives? should be true for system/lattice, false for resume) */
+/* if an entry does not fit in a vector_t, then Overflow is set and the result arrays stay NULL */
 
 void deleteZSolveContext(ZSolveContext, bool);
 /* (context, delete Hom and Inhom?) */
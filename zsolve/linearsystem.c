@@ -247,7 +247,7 @@ int imax(int a, int b)
 
 //                                                                            //
 
-int numberSize(int value)
+int numberSize(vector_t value)
 {
 	int result = 1;
 
@@ -290,7 +290,7 @@ int propertySize(variableproperty_t property)
 
 void fprintLinearSystem(FILE *stream, LinearSystem system)
 {
-	Vector space;
+	int *space;
 	int i,j;
 	bool allfree = true;
 
@@ -300,7 +300,7 @@ void fprintLinearSystem(FILE *stream, LinearSystem system)
 		exit(1);
 	}
 
-	space = createVector(system->Variables+2);
+	space = (int *)malloc((system->Variables+2)*sizeof(int));
 
 	// Collect space need by all columns
 	for (i=0; i<system->Variables; i++)
@@ -347,7 +347,7 @@ void fprintLinearSystem(FILE *stream, LinearSystem system)
 	for (i=0; i<system->Equations; i++)
 	{
 		for (j=0; j<system->Variables; j++)
-			fprintf(stream, "%*d ", space[j], system->A[j][i]);
+			fprintf(stream, VECTOR_T_FORMAT("*") " ", space[j], system->A[j][i]);
 		switch (system->EqProperties[i].Type)
 		{
 			case EQUATION_EQUAL:
@@ -367,13 +367,13 @@ void fprintLinearSystem(FILE *stream, LinearSystem system)
 				fprintf(stream, "%*s ", space[system->Variables], ">=");
 			break;
 		}
-		fprintf(stream, "%*d", space[system->Variables+1], system->b[i]);
+		fprintf(stream, VECTOR_T_FORMAT("*"), space[system->Variables+1], system->b[i]);
 		if (system->EqProperties[i].Type==EQUATION_MODULO)
 			fprintf(stream, " (mod %d)", system->EqProperties[i].Modulus);
 		fprintf(stream, "\n");
 	}
 
-	deleteVector(space);
+	free(space);
 }
 
 //                                                                            //
@@ -452,7 +452,7 @@ LinearSystem homogenizeLinearSystem(LinearSystem old)
 	}
 
 	// -rhs as a new row in [0;1]
-	if (normVector(new->b, old->Equations)>0)
+	if (normVector(new->b, old->Equations)!=0)
 	{
 		new->Variables++;
 		new->A = (Vector *)realloc(new->A, new->Variables*sizeof(Vector));
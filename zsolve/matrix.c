@@ -39,7 +39,7 @@ Matrix createMatrix(int w, int h)
 
 	matrix->Width = w;
 	matrix->Height = h;
-	matrix->Data = (int *)malloc(w*h*sizeof(int));
+	matrix->Data = (vector_t *)malloc(w*h*sizeof(vector_t));
 
 	return matrix;
 }
@@ -89,7 +89,7 @@ Matrix readMatrix(FILE *stream)
 	w *= h;
 	for (i=0; i<w; i++)
 	{
-		if (fscanf(stream, "%d", &(matrix->Data[i]))<1)
+		if (fscanf(stream, VECTOR_T_FORMAT(""), &(matrix->Data[i]))<1)
 		{
 			deleteMatrix(matrix);
 			return NULL;
@@ -113,7 +113,7 @@ void fprintMatrix(FILE *stream, Matrix matrix)
 	for (i=0; i<matrix->Height; i++)
 	{
 		for (j=0; j<matrix->Width; j++)
-			fprintf(stream, "%3d ", matrix->Data[j+matrix->Width*i]);
+			fprintf(stream, VECTOR_T_FORMAT("3") " ", matrix->Data[j+matrix->Width*i]);
 		fprintf(stream, "\n");
 	}
 }
@@ -131,7 +131,8 @@ inline void printMatrix(Matrix matrix)
 
 void swapMatrixRows(Matrix matrix, int a, int b)
 {
-	int i, tmp,w;
+	int i,w;
+	vector_t tmp;
 
 	assert(matrix);
 	assert(a>=0 && a<matrix->Height);
@@ -153,7 +154,8 @@ void swapMatrixRows(Matrix matrix, int a, int b)
 
 void swapMatrixColumns(Matrix matrix, int a, int b)
 {
-	int i, tmp,w;
+	int i,w;
+	vector_t tmp;
 
 	assert(matrix);
 	assert(a>=0 && a<matrix->Width);
@@ -187,9 +189,10 @@ void negateMatrixColumn(Matrix matrix, int col)
 
 //                                                                            //
 
-void combineMatrixColumns(Matrix matrix, int dest, int factor, int src)
+bool combineMatrixColumns(Matrix matrix, int dest, vector_t factor, int src)
 {
 	int i,w;
+	bool overflow = false;
 
 	assert(matrix);
 	assert(dest>=0 && dest<matrix->Width);
@@ -198,7 +201,9 @@ void combineMatrixColumns(Matrix matrix, int dest, int factor, int src)
 
 	w = matrix->Width;
 	for (i=0; i<matrix->Height; i++)
-		matrix->Data[i*w+dest] += factor*matrix->Data[i*w+src];
+		matrix->Data[i*w+dest] = addChecked(matrix->Data[i*w+dest], mulChecked(factor, matrix->Data[i*w+src], &overflow), &overflow);
+
+	return overflow;
 }
 
 //                                                                            //
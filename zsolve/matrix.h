@@ -24,12 +24,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #define _MATRIX_H
 
 #include <stdio.h>
+#include "defs.h"
 
 typedef struct matrix_t
 {
 	int Width;
 	int Height;
-	int *Data;
+	vector_t *Data;
 } matrix_t;
 typedef matrix_t *Matrix;
 
@@ -63,7 +64,7 @@ void swapMatrixColumns(Matrix, int, int);
 void negateMatrixColumn(Matrix, int);
 /* Change the sign of a complete column (matrix, column) */
 
-void combineMatrixColumns(Matrix, int, int, int);
-/* Add a factorized sum of a column src to another column dest (matrix, dest, factor, src) */
+bool combineMatrixColumns(Matrix, int, vector_t, int);
+/* Add a factorized sum of a column src to another column dest, return true on overflow (matrix, dest, factor, src) */
 
 #endif
@@ -0,0 +1,137 @@
+/*
+Pools of fixed size blocks, see pool.h.
+*/
+
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define POOL_MIN_BLOCKS 64
+#define POOL_MAX_BLOCKS 65536
+
+//                                                                            //
+
+Pool createPool(size_t size)
+{
+	Pool pool = (Pool)malloc(sizeof(pool_t));
+
+	if (pool==NULL)
+	{
+		fprintf(stderr, "Fatal Error: Could not allocate memory for Pool!\n");
+		exit(1);
+	}
+
+	// every block must be able to hold the free list link
+	if (size<sizeof(poolalign_t))
+		size = sizeof(poolalign_t);
+	pool->Size = (size+sizeof(poolalign_t)-1)/sizeof(poolalign_t)*sizeof(poolalign_t);
+	pool->Chunks = NULL;
+	pool->Next = 0;
+	pool->Free = NULL;
+	pool->Used = 0;
+	pool->HighWater = 0;
+
+	return pool;
+}
+
+//                                                                            //
+
+void deletePool(Pool pool)
+{
+	poolchunk_t *chunk;
+
+	if (pool)
+	{
+		while ((chunk = pool->Chunks)!=NULL)
+		{
+			pool->Chunks = chunk->next;
+			free(chunk);
+		}
+		free(pool);
+	}
+}
+
+//                                                                            //
+
+void *allocFromPool(Pool pool)
+{
+	poolchunk_t *chunk;
+	void *block;
+	int blocks;
+
+	assert(pool);
+
+	if (pool->Free)
+	{
+		block = pool->Free;
+		pool->Free = *(void **)block;
+	}
+	else
+	{
+		if (pool->Chunks==NULL || pool->Next==pool->Chunks->Blocks)
+		{
+			blocks = pool->Chunks==NULL ? POOL_MIN_BLOCKS : 2*pool->Chunks->Blocks;
+			if (blocks>POOL_MAX_BLOCKS)
+				blocks = POOL_MAX_BLOCKS;
+			chunk = (poolchunk_t *)malloc(offsetof(poolchunk_t, Data)+blocks*pool->Size);
+			if (chunk==NULL)
+			{
+				fprintf(stderr, "Fatal Error: Could not allocate memory for Pool!\n");
+				exit(1);
+			}
+			chunk->Blocks = blocks;
+			chunk->next = pool->Chunks;
+			pool->Chunks = chunk;
+			pool->Next = 0;
+		}
+		block = (char *)pool->Chunks->Data + pool->Next*pool->Size;
+		pool->Next++;
+	}
+
+	pool->Used++;
+	if (pool->Used>pool->HighWater)
+		pool->HighWater = pool->Used;
+
+	return block;
+}
+
+//                                                                            //
+
+void releaseToPool(Pool pool, void *block)
+{
+	assert(pool);
+
+	if (block)
+	{
+		assert(pool->Used>0);
+		*(void **)block = pool->Free;
+		pool->Free = block;
+		pool->Used--;
+	}
+}
+
+//                                                                            //
+
+void clearPool(Pool pool)
+{
+	poolchunk_t *chunk;
+
+	assert(pool);
+
+	// the most recent chunk is the largest one
+	if (pool->Chunks)
+	{
+		while ((chunk = pool->Chunks->next)!=NULL)
+		{
+			pool->Chunks->next = chunk->next;
+			free(chunk);
+		}
+	}
+	pool->Next = 0;
+	pool->Free = NULL;
+	pool->Used = 0;
+}
+
+//                                                                            //
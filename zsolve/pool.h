@@ -0,0 +1,56 @@
+/*
+Pools of fixed size blocks, used for the value trees and the lattice
+vectors, which are created and discarded in large numbers.
+Blocks are carved from chunks of increasing size and released blocks
+are kept on a free list for reuse.  All blocks of a pool can be released
+at once with clearPool.  A pool is not thread-safe.
+The functions do not depend on the type of the entries and are shared
+by both instances of zsolve.
+*/
+
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <stddef.h>
+
+typedef union poolalign_t
+{
+	long long l;
+	double d;
+	void *p;
+} poolalign_t;
+
+typedef struct poolchunk_t
+{
+	struct poolchunk_t *next;
+	int Blocks;
+	poolalign_t Data[1];
+} poolchunk_t;
+
+typedef struct pool_t
+{
+	size_t Size;
+	poolchunk_t *Chunks;
+	int Next;
+	void *Free;
+	int Used;
+	int HighWater;
+} pool_t;
+typedef pool_t *Pool;
+
+Pool createPool(size_t);
+/* create a pool (block size) */
+
+void deletePool(Pool);
+/* delete a pool and all its blocks (pool) */
+
+void *allocFromPool(Pool);
+/* allocate a block (pool) */
+
+void releaseToPool(Pool, void *);
+/* return a block for reuse (pool, block) */
+
+void clearPool(Pool);
+/* release all blocks at once, keeping only the largest chunk (pool) */
+
+#endif
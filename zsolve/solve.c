@@ -915,6 +915,19 @@ int main(int argc, char *argv[])
 
 	zsolveSystem(ctx, !OResume);
 
+	if (ctx->Overflow)
+	{
+		printf("Integer overflow: the entries of the solutions do not fit in the integer type of zsolve.\n");
+		if (LogFile)
+			fprintf(LogFile, "Integer overflow: the entries of the solutions do not fit in the integer type of zsolve.\n");
+		deleteZSolveContext(ctx, true);
+		if (BaseName!=NULL)
+			free(BaseName);
+		if (LogFile)
+			fclose(LogFile);
+		return EXIT_FAILURE;
+	}
+
 	if (OGraver)
 	{
 		printf("Writing %d vectors to graver file, with respect to symmetry.\n", ctx->Graver->Size);
@@ -31,15 +31,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 //                                                                            //
 
-ValueTree createValueTree(int level)
+ValueTree createValueTree(ZSolveContext ctx, int level)
 {
-	ValueTree tree = (ValueTree)malloc(sizeof(valuetree_t));
-
-	if (tree==NULL)
-	{
-		fprintf(stderr, "Fatal Error: Could not allocate memory for ValueTree!\n");
-		exit(1);
-	}
+	ValueTree tree = (ValueTree)allocFromPool(ctx->TreePool);
 
 	tree->level = level;
 	tree->pos = NULL;
@@ -52,27 +46,20 @@ ValueTree createValueTree(int level)
 
 //                                                                            //
 
+// the trees and nodes themselves are released at once by deleteValueTrees
+
 void deleteValueTree(ValueTree tree)
 {
 	ValueTreeNode node;
 
 	if (tree!=NULL)
 	{
-		while ((node = tree->pos)!=NULL)
-		{
-			tree->pos = node->next;
+		for (node = tree->pos; node!=NULL; node = node->next)
 			deleteValueTree(node->sub);
-			free(node);
-		}
-		while ((node = tree->neg)!=NULL)
-		{
-			tree->neg = node->next;
+		for (node = tree->neg; node!=NULL; node = node->next)
 			deleteValueTree(node->sub);
-			free(node);
-		}
 		deleteValueTree(tree->zero);
 		deleteIndexArray(tree->vectors);
-		free(tree);
 	}
 }
 
@@ -80,7 +67,8 @@ void deleteValueTree(ValueTree tree)
 
 void splitValueTree(ZSolveContext ctx, ValueTree tree, int start)
 {
-	int i, compo, value;
+	int i, compo;
+	vector_t value;
 	bool pos, neg, zero;
 	ValueTreeNode node, temp;
 
@@ -123,10 +111,10 @@ void splitValueTree(ZSolveContext ctx, ValueTree tree, int start)
 				node = tree->pos;
 				if (node==NULL || value<node->value)
 				{
-					tree->pos = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+					tree->pos = (ValueTreeNode)allocFromPool(ctx->NodePool);
 					tree->pos->value = value;
 					tree->pos->next = node;
-					tree->pos->sub = createValueTree(-1);
+					tree->pos->sub = createValueTree(ctx, -1);
 					appendToIndexArray(tree->pos->sub->vectors, tree->vectors->Data[i]);
 				}
 				else
@@ -135,9 +123,9 @@ void splitValueTree(ZSolveContext ctx, ValueTree tree, int start)
 						node = node->next;
 					if (value!=node->value)
 					{
-						temp = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+						temp = (ValueTreeNode)allocFromPool(ctx->NodePool);
 						temp->value = value;
-						temp->sub = createValueTree(-1);
+						temp->sub = createValueTree(ctx, -1);
 						temp->next = node->next;
             node->next = temp;
 						node = temp;
@@ -150,10 +138,10 @@ void splitValueTree(ZSolveContext ctx, ValueTree tree, int start)
 				node = tree->neg;
 				if (node==NULL || value>node->value)
 				{
-					tree->neg = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+					tree->neg = (ValueTreeNode)allocFromPool(ctx->NodePool);
 					tree->neg->value = value;
 					tree->neg->next = node;
-					tree->neg->sub = createValueTree(-1);
+					tree->neg->sub = createValueTree(ctx, -1);
 					appendToIndexArray(tree->neg->sub->vectors, tree->vectors->Data[i]);
 				}
 				else
@@ -162,9 +150,9 @@ void splitValueTree(ZSolveContext ctx, ValueTree tree, int start)
 						node = node->next;
 					if (value!=node->value)
 					{
-						temp = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+						temp = (ValueTreeNode)allocFromPool(ctx->NodePool);
 						temp->value = value;
-						temp->sub = createValueTree(-1);
+						temp->sub = createValueTree(ctx, -1);
 						temp->next = node->next;
 						node->next = temp;
 						node = temp;
@@ -175,7 +163,7 @@ void splitValueTree(ZSolveContext ctx, ValueTree tree, int start)
 			else
 			{
 				if (tree->zero==NULL)
-					tree->zero = createValueTree(-1);
+					tree->zero = createValueTree(ctx, -1);
 				appendToIndexArray(tree->zero->vectors, tree->vectors->Data[i]);
 			}
 		}
@@ -210,7 +198,18 @@ void createValueTrees(ZSolveContext ctx)
 
 	ctx->MaxNorm = 0;
 	for (i=0; i<ctx->Lattice->Size; i++)
-		ctx->MaxNorm = maxi(ctx->MaxNorm, normVector(ctx->Lattice->Data[i], ctx->Current));
+	{
+		j = normVector(ctx->Lattice->Data[i], ctx->Current);
+		if (j<0)
+		{
+			// leave empty trees
+			ctx->Overflow = true;
+			ctx->MaxNorm = 0;
+			ctx->Norm = (void **)calloc(1, sizeof(ValueTree));
+			return;
+		}
+		ctx->MaxNorm = maxi(ctx->MaxNorm, j);
+	}
 
 	ctx->Norm = (void **)calloc(ctx->MaxNorm+1, sizeof(ValueTree));
 
@@ -222,7 +221,7 @@ void createValueTrees(ZSolveContext ctx)
 			continue;
 		// put in corresponding norm-tree
 		if (ctx->Norm[j]==NULL)
-			ctx->Norm[j] = createValueTree(-1);
+			ctx->Norm[j] = createValueTree(ctx, -1);
 		appendToIndexArray( ((ValueTree *)ctx->Norm)[j]->vectors, i);
 	}
 
@@ -238,6 +237,8 @@ void deleteValueTrees(ZSolveContext ctx)
 
 	for (i=0; i<=ctx->MaxNorm; i++)
 		deleteValueTree(ctx->Norm[i]);
+	clearPool(ctx->TreePool);
+	clearPool(ctx->NodePool);
 
 	free(ctx->Norm);
 	ctx->Norm = NULL;
@@ -247,7 +248,8 @@ void deleteValueTrees(ZSolveContext ctx)
 
 bool enumValueReducer(ZSolveContext ctx, ValueTree tree)
 {
-	int value, i, j;
+	vector_t value;
+	int i, j;
 	Vector Reducer;
 	ValueTreeNode node;
 
@@ -290,7 +292,7 @@ bool enumValueReducer(ZSolveContext ctx, ValueTree tree)
 				printVector(Reducer, ctx->Variables);
 				printf("]\n"); */
 				for (j=0; j<=ctx->Current; j++)
-					if (Reducer[j]*ctx->Sum[j]<0 || abs(ctx->Sum[j])<abs(Reducer[j]))
+					if (signm(Reducer[j])*signm(ctx->Sum[j])<0 || absm(ctx->Sum[j])<absm(Reducer[j]))
 						break;
 				if (j>ctx->Current)
 					return true;
@@ -304,7 +306,7 @@ bool enumValueReducer(ZSolveContext ctx, ValueTree tree)
 
 void insertVectorToValueTree(ZSolveContext ctx, ValueTree tree, int index)
 {
-	int value;
+	vector_t value;
 	ValueTreeNode node, temp;
 
 	assert(tree);
@@ -318,10 +320,10 @@ void insertVectorToValueTree(ZSolveContext ctx, ValueTree tree, int index)
 			node = tree->pos;
 			if (node==NULL || value<node->value)
 			{
-				tree->pos = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+				tree->pos = (ValueTreeNode)allocFromPool(ctx->NodePool);
 				tree->pos->value = value;
 				tree->pos->next = node;
-				tree->pos->sub = createValueTree(-1);
+				tree->pos->sub = createValueTree(ctx, -1);
 				appendToIndexArray(tree->pos->sub->vectors, index);
 			}
 			else
@@ -332,9 +334,9 @@ void insertVectorToValueTree(ZSolveContext ctx, ValueTree tree, int index)
 					insertVectorToValueTree(ctx, node->sub, index);
 				else
 				{
-					temp = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+					temp = (ValueTreeNode)allocFromPool(ctx->NodePool);
 					temp->value = value;
-					temp->sub = createValueTree(-1);
+					temp->sub = createValueTree(ctx, -1);
 					appendToIndexArray(temp->sub->vectors, index);
 					temp->next = node->next;
 					node->next = temp;
@@ -346,10 +348,10 @@ void insertVectorToValueTree(ZSolveContext ctx, ValueTree tree, int index)
 			node = tree->neg;
 			if (node==NULL || value>node->value)
 			{
-				tree->neg = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+				tree->neg = (ValueTreeNode)allocFromPool(ctx->NodePool);
 				tree->neg->value = value;
 				tree->neg->next = node;
-				tree->neg->sub = createValueTree(-1);
+				tree->neg->sub = createValueTree(ctx, -1);
 				appendToIndexArray(tree->neg->sub->vectors, index);
 			}
 			else
@@ -360,9 +362,9 @@ void insertVectorToValueTree(ZSolveContext ctx, ValueTree tree, int index)
 					insertVectorToValueTree(ctx, node->sub, index);
 				else
 				{
-					temp = (ValueTreeNode)malloc(sizeof(valuetreenode_t));
+					temp = (ValueTreeNode)allocFromPool(ctx->NodePool);
 					temp->value = value;
-					temp->sub = createValueTree(-1);
+					temp->sub = createValueTree(ctx, -1);
 					appendToIndexArray(temp->sub->vectors, index);
 					temp->next = node->next;
 					node->next = temp;
@@ -373,7 +375,7 @@ void insertVectorToValueTree(ZSolveContext ctx, ValueTree tree, int index)
 		{
 			if (tree->zero==NULL)
 			{
-				tree->zero = createValueTree(-1);
+				tree->zero = createValueTree(ctx, -1);
 				appendToIndexArray(tree->zero->vectors, index);
 			}
 			else
@@ -401,7 +403,7 @@ void insertVectorToValueTrees(ZSolveContext ctx, Vector vector, int norm)
 	appendToVectorArray(ctx->Lattice, vector);
 	if (ctx->Norm[norm]==NULL)
 	{
-		ctx->Norm[norm] = createValueTree(-1);
+		ctx->Norm[norm] = createValueTree(ctx, -1);
 		appendToIndexArray(((ValueTree *)ctx->Norm)[norm]->vectors, ctx->Lattice->Size-1);
 	}
 	else
@@ -410,9 +412,39 @@ void insertVectorToValueTrees(ZSolveContext ctx, Vector vector, int norm)
 
 //                                                                            //
 
+Vector copySumToPool(ZSolveContext ctx)
+{
+	int i;
+	Vector vector = (Vector)allocFromPool(ctx->VectorPool);
+
+	for (i=0; i<ctx->Variables; i++)
+		vector[i] = ctx->Sum[i];
+
+	return vector;
+}
+
+//                                                                            //
+
+void insertValueSum(ZSolveContext ctx, int norm)
+{
+	int i;
+
+	insertVectorToValueTrees(ctx, copySumToPool(ctx), norm);
+
+	if (ctx->Symmetric)
+	{
+		for (i=0; i<ctx->Variables; i++)
+			ctx->Sum[i] = -ctx->Sum[i];
+		insertVectorToValueTrees(ctx, copySumToPool(ctx), norm);
+	}
+}
+
+//                                                                            //
+
 void buildValueSum(ZSolveContext ctx)
 {
 	int i,norm;
+	vector_t total;
 	bool flag;
 
 	assert(ctx->First);
@@ -424,23 +456,31 @@ void buildValueSum(ZSolveContext ctx)
 		return;
 
 	// pattern okay ?
-	if (ctx->First[ctx->Current]*ctx->Second[ctx->Current]>0)
+	if (signm(ctx->First[ctx->Current])*signm(ctx->Second[ctx->Current])>0)
 		return;
 	flag = false;
 	for (i=0; i<ctx->Current; i++)
-		if (ctx->First[i]*ctx->Second[i]<0)
+		if (signm(ctx->First[i])*signm(ctx->Second[i])<0)
 			flag = true;
 	if (flag)
 		return;
 
 	// build new
-	norm = 0;
+	flag = false;
+	total = 0;
 	for (i=0; i<ctx->Variables; i++)
 	{
-		ctx->Sum[i] = ctx->First[i] + ctx->Second[i];
+		ctx->Sum[i] = addChecked(ctx->First[i], ctx->Second[i], &flag);
 		if (i<ctx->Current)
-			norm += abs(ctx->Sum[i]);
+			total = addChecked(total, absm(ctx->Sum[i]), &flag);
+	}
+	// overflow ?
+	if (flag || total>MAXINT)
+	{
+		ctx->Overflow = true;
+		return;
 	}
+	norm = (int)total;
 	// all zero?
 	if (norm==0)
 		return;
@@ -471,12 +511,8 @@ void buildValueSum(ZSolveContext ctx)
 	// limits okay ?
 	for (i=0; i<ctx->Current; i++)
 	{
-		if (ctx->Lattice->Properties[i].Lower>ctx->Sum[i]) {
-//			printf("(lower bounds failed)\n");
-			return;
-		}
-		if (ctx->Lattice->Properties[i].Upper<ctx->Sum[i]) {
-//			printf("(upper bounds failed)\n");
+		if (!checkVariableBounds(ctx->Lattice->Properties, i, ctx->Sum[i])) {
+//			printf("(bounds failed)\n");
 			return;
 		}
 	}
@@ -485,14 +521,15 @@ void buildValueSum(ZSolveContext ctx)
 		if (enumValueReducer(ctx, ctx->Norm[norm]))
 			return;
 
-	insertVectorToValueTrees(ctx, copyVector(ctx->Sum, ctx->Variables), norm);
-
-	if (ctx->Symmetric)
+	// collected for merging ?
+	// (not from the pool, as the tasks may run concurrently)
+	if (ctx->Candidates)
 	{
-		for (i=0; i<ctx->Variables; i++)
-			ctx->Sum[i] = -ctx->Sum[i];
-		insertVectorToValueTrees(ctx, copyVector(ctx->Sum, ctx->Variables), norm);
+		appendToVectorArray(ctx->Candidates, copyVector(ctx->Sum, ctx->Variables));
+		return;
 	}
+
+	insertValueSum(ctx, norm);
 }
 
 //                                                                            //
@@ -609,12 +646,181 @@ void enumValueFirst(ZSolveContext ctx, ValueTree tree, int norm)
 
 //                                                                            //
 
+void collectValueFirst(ZSolveContext ctx, ValueTree tree, IndexArray firsts)
+{
+	int i;
+	Vector first;
+	ValueTreeNode node;
+
+	if (tree)
+	{
+		if (tree->level>=0)
+		{
+			node = tree->pos;
+			while (node)
+			{
+				collectValueFirst(ctx, node->sub, firsts);
+				node = node->next;
+			}
+			collectValueFirst(ctx, tree->zero, firsts);
+			node = tree->neg;
+			while (node)
+			{
+				collectValueFirst(ctx, node->sub, firsts);
+				node = node->next;
+			}
+		}
+		else
+		{
+			for (i=0; i<tree->vectors->Size; i++)
+			{
+				first = ctx->Lattice->Data[tree->vectors->Data[i]];
+				if ((!ctx->Symmetric && first[ctx->Current]<0) || first[ctx->Current]>0)
+					appendToIndexArray(firsts, tree->vectors->Data[i]);
+			}
+		}
+	}
+}
+
+//                                                                            //
+
+// data shared by the tasks of a parallel completion round
+
+typedef struct completionround_t
+{
+	ZSolveContext ctx;
+	int norm;
+	IndexArray firsts;
+	int start, end;
+	VectorArray *candidates;
+	bool *overflow;
+} completionround_t;
+
+// collect the sums of the i-th first vector with the second vectors
+// in the norm tree (if start<0) or the vectors start..end-1 of the lattice
+// on a private copy of the context, leaving the value trees untouched
+
+void completeValueFirst(int i, void *user)
+{
+	completionround_t *round = (completionround_t *)user;
+	zsolvecontext_t local = *round->ctx;
+	int j;
+
+	local.Sum = createVector(local.Variables);
+	local.Candidates = round->candidates[i];
+	local.First = local.Lattice->Data[round->firsts->Data[i]];
+
+	if (round->start<0)
+		enumValueSecond(&local, local.Norm[round->norm]);
+	else
+	{
+		for (j=round->start; j<round->end; j++)
+		{
+			local.Second = local.Lattice->Data[j];
+			if (local.Second[local.Current]!=0)
+				buildValueSum(&local);
+		}
+	}
+
+	deleteVector(local.Sum);
+	round->overflow[i] = local.Overflow;
+}
+
+//                                                                            //
+
+// insert the collected candidates in the order of the first vectors
+// and return the number of new vectors
+
+int mergeValueCandidates(ZSolveContext ctx, completionround_t *round)
+{
+	int i, j, k, norm;
+	int size = ctx->Lattice->Size;
+	VectorArray candidates;
+
+	for (i=0; i<round->firsts->Size; i++)
+	{
+		candidates = round->candidates[i];
+		for (j=0; j<candidates->Size; j++)
+		{
+			norm = normVector(candidates->Data[j], ctx->Current);
+			for (k=0; k<ctx->Variables; k++)
+				ctx->Sum[k] = candidates->Data[j][k];
+			// reducable by a vector of this round ?
+			if (norm<=ctx->MaxNorm)
+				if (enumValueReducer(ctx, ctx->Norm[norm]))
+					continue;
+			insertValueSum(ctx, norm);
+		}
+		deleteVectorArray(candidates);
+		round->candidates[i] = createVectorArray(ctx->Variables);
+	}
+
+	return ctx->Lattice->Size - size;
+}
+
+//                                                                            //
+
+// The pairs are enumerated in parallel, each task collecting
+// the candidate sums of a single first vector without modifying the trees.
+// The candidates are then merged in the order of the first vectors,
+// dropping those that are reduced by vectors inserted before them,
+// such that the result does not depend on the number of threads.
+// If norm1 is zero, then the new vectors end up in the tree of norm2
+// and they are combined with the first vectors in further rounds.
+
+void completeValueTreesParallel(ZSolveContext ctx, int norm1, int norm2)
+{
+	completionround_t round;
+	int i, added;
+
+	round.ctx = ctx;
+	round.norm = norm2;
+	round.firsts = createIndexArray();
+	collectValueFirst(ctx, ctx->Norm[norm1], round.firsts);
+
+	round.candidates = (VectorArray *)malloc(round.firsts->Size*sizeof(VectorArray));
+	round.overflow = (bool *)calloc(round.firsts->Size, sizeof(bool));
+	if (round.firsts->Size>0 && (round.candidates==NULL || round.overflow==NULL))
+	{
+		fprintf(stderr, "Fatal Error: Could not allocate memory for candidates!\n");
+		exit(1);
+	}
+	for (i=0; i<round.firsts->Size; i++)
+		round.candidates[i] = createVectorArray(ctx->Variables);
+
+	round.start = -1;
+	do
+	{
+		round.end = ctx->Lattice->Size;
+		ctx->ParallelCallback(round.firsts->Size, completeValueFirst, &round, ctx->ParallelData);
+		for (i=0; i<round.firsts->Size; i++)
+			if (round.overflow[i])
+				ctx->Overflow = true;
+		if (ctx->Overflow)
+			break;
+		added = mergeValueCandidates(ctx, &round);
+		round.start = round.end;
+	}
+	while (norm1==0 && added>0);
+
+	for (i=0; i<round.firsts->Size; i++)
+		deleteVectorArray(round.candidates[i]);
+	free(round.candidates);
+	free(round.overflow);
+	deleteIndexArray(round.firsts);
+}
+
+//                                                                            //
+
 void completeValueTrees(ZSolveContext ctx, int norm1, int norm2)
 {
 	assert(ctx->Norm);
 	assert(!(norm1>ctx->MaxNorm || norm2>ctx->MaxNorm || ctx->Norm[norm1]==NULL || ctx->Norm[norm2]==NULL));
 
-	enumValueFirst(ctx, ctx->Norm[norm1], norm2);
+	if (ctx->ParallelCallback)
+		completeValueTreesParallel(ctx, norm1, norm2);
+	else
+		enumValueFirst(ctx, ctx->Norm[norm1], norm2);
 }
 
 //                                                                            //
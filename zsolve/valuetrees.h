@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 typedef struct valuetreenode_t
 {
-	int value;
+	vector_t value;
 	struct valuetree_t *sub;
 	struct valuetreenode_t *next;
 } valuetreenode_t;
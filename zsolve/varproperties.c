@@ -83,12 +83,12 @@ bool checkVariableFree(VariableProperties var, int id)
 
 //                                                                            //
 
-bool checkVariableBounds(VariableProperties var, int id, int num)
+bool checkVariableBounds(VariableProperties var, int id, vector_t num)
 {
 	assert(var);
 	assert(id>=0);
 
-	return var[id].Lower<=num && num<=var[id].Upper;
+	return (var[id].Lower==-MAXINT || var[id].Lower<=num) && (var[id].Upper==MAXINT || num<=var[id].Upper);
 }
 
 //                                                                            //
@@ -56,7 +56,7 @@ bool checkVariableSymmetry(VariableProperties, int);
 bool checkVariableFree(VariableProperties, int);
 /* Is variable free? (variable, id) */
 
-bool checkVariableBounds(VariableProperties, int, int);
+bool checkVariableBounds(VariableProperties, int, vector_t);
 /* is given number in bounds? (variable, id, num) */
 
 void fprintVariableProperties(FILE *, VariableProperties, int);
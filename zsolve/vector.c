@@ -89,9 +89,9 @@ void fprintVector(FILE *stream, Vector vector, int size)
 	assert(stream);
 	assert(vector);
 
-	fprintf(stream, "%2d", vector[0]);
+	fprintf(stream, VECTOR_T_FORMAT("2"), vector[0]);
 	for (i=1; i<size; i++)
-		fprintf(stream, " %2d", vector[i]);
+		fprintf(stream, " " VECTOR_T_FORMAT("2"), vector[i]);
 }
 
 //                                                                            //
@@ -117,7 +117,7 @@ Vector readVector(FILE *stream, int size)
 
 	for (i=0; i<size; i++)
 	{
-		if (fscanf(stream, "%d", &(vector[i]))<1)
+		if (fscanf(stream, VECTOR_T_FORMAT(""), &(vector[i]))<1)
 		{
 			deleteVector(vector);
 			return NULL;
@@ -131,22 +131,23 @@ Vector readVector(FILE *stream, int size)
 
 int normVector(Vector vector, int size)
 {
-	int norm = 0;
+	vector_t norm = 0;
+	bool overflow = false;
 
 	assert(vector);
 
 	if (size>=0)
 		while (size--)
-			norm += abs(vector[size]);
+			norm = addChecked(norm, absm(vector[size]), &overflow);
 
-	return norm;
+	return overflow || norm>MAXINT ? -1 : (int)norm;
 }
 
 //                                                                            //
 
 void swapVector(Vector vector, int a, int b)
 {
-	int tmp;
+	vector_t tmp;
 
 	assert(vector);
 
@@ -157,9 +158,10 @@ void swapVector(Vector vector, int a, int b)
 
 //                                                                            //
 
-int gcdVector(Vector vector, int size)
+vector_t gcdVector(Vector vector, int size)
 {
-	int i,result;
+	int i;
+	vector_t result;
 
 	if (size==0)
 		return 0;
@@ -177,7 +179,7 @@ int lexCompareInverseVector(Vector vector, int size) {
 	int i = 0;
 	while (i<size && vector[i]==0)
 		i++;
-	return i==size ? 0 : vector[i];
+	return i==size ? 0 : (vector[i]>0 ? 1 : -1);
 }
 
 //                                                                            //
@@ -27,7 +27,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 #include "defs.h"
 
-typedef int vector_t;
 typedef vector_t *Vector;
 
 Vector createVector(int);
@@ -52,12 +51,12 @@ Vector readVector(FILE *, int);
 /* Read from stream (stream, size) */
 
 int normVector(Vector, int);
-/* L1-norm (vector, size) */
+/* L1-norm (vector, size), -1 if it does not fit in an int */
 
 void swapVector(Vector, int, int);
 /* Swap vector[a] and vector[b] (vector, a, b) */
 
-int gcdVector(Vector, int);
+vector_t gcdVector(Vector, int);
 /* gcd of all numbers (vector, size) */
 
 int lexCompareInverseVector(Vector, int);